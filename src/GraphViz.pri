@@ -1,6 +1,4 @@
 DEFINES += WITH_CGRAPH
-INCLUDEPATH += private
-QMAKE_CXXFLAGS += -DQGVCORE_LIB
 
 include(../config)
 
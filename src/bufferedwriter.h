@@ -0,0 +1,62 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#pragma once
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+#include <string>
+
+// Accumulates text in a fixed size buffer and hands it to the underlying device in large
+// chunks, so that writers can emit documents piece by piece without building them in memory.
+// Strings are written UTF-8 encoded. Write errors are sticky and reported by [ok].
+
+class BufferedWriter
+{
+public:
+  explicit BufferedWriter(QIODevice *device, int capacity = 1 << 16)
+    : device(device), capacity(capacity), error(false)
+  {
+    buffer.reserve(capacity);
+  }
+
+  ~BufferedWriter() { flush(); }
+
+  BufferedWriter& operator<<(const char *s) { return write(s, (int)qstrlen(s)); }
+  BufferedWriter& operator<<(const std::string& s) { return write(s.data(), (int)s.size()); }
+  BufferedWriter& operator<<(const QByteArray& s) { return write(s.constData(), s.size()); }
+  BufferedWriter& operator<<(const QString& s) { return *this << s.toUtf8(); }
+  BufferedWriter& operator<<(char c) { return write(&c, 1); }
+
+  BufferedWriter& write(const char *s, int n)
+  {
+    if ( buffer.size() + n > capacity ) flush();
+    buffer.append(s, n);
+    return *this;
+  }
+
+  void flush()
+  {
+    if ( buffer.isEmpty() ) return;
+    if ( ! error && device->write(buffer) != buffer.size() ) error = true;
+    buffer.resize(0);  // Keeps the allocated capacity
+  }
+
+  bool ok() const { return ! error; }
+
+private:
+  QIODevice *device;
+  int capacity;
+  bool error;
+  QByteArray buffer;
+};
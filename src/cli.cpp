@@ -0,0 +1,740 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "cli.h"
+#include "graph.h"
+#include "exporter.h"
+#include "scenebench.h"
+#include "include/nlohmann_json.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QSet>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QTemporaryFile>
+#include <QProcess>
+#include <QMap>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QBuffer>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <functional>
+
+enum Command { NoCommand, ToDot, ToJson, ToFsdb, ToScxml, Stats };
+
+static const char *usage =
+  "Usage: ssde [file]\n"
+  "       ssde --to-dot FILE [-o OUTPUT]\n"
+  "       ssde --to-json FILE [-o OUTPUT] [--compact]\n"
+  "       ssde --to-fsdb FILE -o OUTPUT\n"
+  "       ssde --to-scxml FILE [-o OUTPUT]\n"
+  "       ssde --stats FILE\n"
+  "       ssde --bench-export [TRANSITIONS|FILE]\n"
+  "       ssde --bench-scene [--input FILE | --states N [--density D] [--long L]] [--steps N] [-o OUTPUT]\n"
+  "       ssde --batch (--to-dot|--to-json|--to-fsdb|--to-scxml) [-o DIR] [-j JOBS] [--compact]\n"
+  "            [--files-from LIST] PATH...\n"
+  "FILE can be either in .fsd, .fsdb or .scxml format. Results are written on the standard output\n"
+  "unless an OUTPUT file is given.\n"
+  "In batch mode, each PATH is either a file or a directory, searched recursively for .fsd,\n"
+  ".fsdb and .scxml files. LIST is a file listing one PATH per line (- for the standard input).\n"
+  "Results are written next to each file, or under DIR, with the extension of the output\n"
+  "format (appended to the input file name when several inputs would share an output, or an\n"
+  "output would replace another input). Files whose output would replace them are skipped.\n"
+  "Files are processed in parallel, by JOBS threads (default: one per core).\n"
+  "--bench-export times the export and loading of a diagram, read from FILE or generated\n"
+  "(default: 100000 transitions), in each format. It checks that the .fsd output is that of\n"
+  "the former DOM based writer and that saving to and reading back each format preserves the\n"
+  "diagram. It also compares the loading of .fsd contents by the streaming loader and through\n"
+  "a DOM (time and peak memory, on Linux), the opening of 1, 10 and 100 MB .fsd files, mapped\n"
+  "in memory or read as text, and times --stats and --to-dot, from startup to exit, on a small\n"
+  "file.\n"
+  "--bench-scene reads a diagram from FILE, or generates one with N states (default: 2000),\n"
+  "D transitions per state (default: 2), a proportion L of them (default: 0.05) being long\n"
+  "edges, and times its repaint at several zoom levels, the drag of its most connected state,\n"
+  "the drag of a 1000 states selection and label edits, each over N frames or steps\n"
+  "(default: 50), in a 1920x1080 view. It then times, on generated diagrams, the repaint of\n"
+  "5k transitions, the state and transition accessors with 1k to 100k states and the\n"
+  "deletion of a state with 10k transitions. Results are written in JSON format.\n"
+  "It replaces --bench-render and --bench-drag, whose figures are now its \"zoom\" and\n"
+  "\"state_drag\" results.\n";
+
+static int error(const QString& msg)
+{
+  fprintf(stderr, "ssde: %s\n", msg.toLocal8Bit().constData());
+  return 1;
+}
+
+static bool write(const Graph& graph, Command command, QIODevice *device, bool compact)
+{
+  switch ( command ) {
+    case ToDot: return graph.exportDot(device);
+    case ToJson: return graph.toJson(device, compact);
+    case ToFsdb: return graph.toBinary(device);
+    case ToScxml: return graph.toScxml(device);
+    default: return false;
+    }
+}
+
+static const char *extension(Command command)
+{
+  switch ( command ) {
+    case ToDot: return "dot";
+    case ToJson: return "fsd";
+    case ToFsdb: return "fsdb";
+    case ToScxml: return "scxml";
+    default: return "";
+    }
+}
+
+bool isCommandLineMode(int argc, char *argv[])
+{
+  return argc > 1 && strncmp(argv[1], "--", 2) == 0;
+}
+
+static void printStats(const Graph& graph)
+{
+  int nbSelf = 0;
+  for ( const Graph::Edge& edge: graph.edges() )
+    if ( edge.src == edge.dst ) nbSelf++;
+  int init = graph.initNode();
+  int initTarget = -1;
+  if ( init >= 0 )
+    for ( const Graph::Edge& edge: graph.edges() )
+      if ( (int)edge.src == init ) { initTarget = edge.dst; break; }
+  QSet<quint32> ids;
+  bool duplicates = false;
+  for ( const Graph::Node& node: graph.nodes() ) {
+    if ( ids.contains(node.id) ) { duplicates = true; break; }
+    ids.insert(node.id);
+    }
+  printf("states: %d\n", graph.nodes().count() - (init >= 0 ? 1 : 0));
+  printf("transitions: %d\n", graph.edges().count() - (initTarget >= 0 ? 1 : 0));
+  printf("self_transitions: %d\n", nbSelf);
+  printf("initial_state: %s\n", initTarget >= 0 ? graph.nodeId(initTarget).toUtf8().constData() : "");
+  printf("duplicate_ids: %s\n", duplicates ? "yes" : "no");
+}
+
+// Batch mode
+
+class BatchReport
+{
+public:
+  BatchReport() : nbFailures(0) { }
+
+  void success(const QString& input, qint64 nsecs)
+  {
+    QMutexLocker lock(&mutex);
+    printf("%10.3f ms  %s\n", nsecs / 1e6, input.toLocal8Bit().constData());
+    fflush(stdout);
+  }
+
+  void failure(const QString& input, const QString& msg)
+  {
+    nbFailures.ref();
+    QMutexLocker lock(&mutex);
+    error(input + ": " + msg);
+  }
+
+  int failures() const { return nbFailures.load(); }
+
+private:
+  QMutex mutex;  // Keeps report lines whole
+  QAtomicInt nbFailures;
+};
+
+// Each job loads one file in its own graph and streams the result to its output file.
+// Jobs share no data, so that they can run on all cores without contention
+
+class BatchJob : public QRunnable
+{
+public:
+  BatchJob(Command command, bool compact, const QString& input, const QString& output, BatchReport *report)
+    : command(command), compact(compact), input(input), output(output), report(report) { }
+
+  void run() override
+  {
+    QElapsedTimer timer;
+    timer.start();
+    try {
+      Graph graph;
+      graph.load(input);
+      // The output file only replaces an existing one once completely written
+      QSaveFile file(output);
+      if ( ! file.open(command == ToFsdb ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text) ) {
+        report->failure(input, output + ": " + file.errorString());
+        return;
+        }
+      if ( ! write(graph, command, &file, compact) || ! file.commit() ) {
+        report->failure(input, output + ": write error");
+        return;
+        }
+    }
+    catch ( const std::exception& e ) {
+      report->failure(input, e.what());
+      return;
+    }
+    report->success(input, timer.nsecsElapsed());
+  }
+
+private:
+  Command command;
+  bool compact;
+  QString input, output;
+  BatchReport *report;
+};
+
+// Adds to [jobs] the (input, output) pairs designated by [path]. The output files of a directory
+// keep their relative location under [outDir]
+static void collectJobs(const QString& path, const QString& outDir, Command command, QList<QPair<QString,QString> >& jobs)
+{
+  QFileInfo info(path);
+  QString ext = extension(command);
+  if ( info.isDir() ) {
+    QDir root(path);
+    QDirIterator it(path, QStringList() << "*.fsd" << "*.fsdb" << "*.scxml", QDir::Files, QDirIterator::Subdirectories);
+    while ( it.hasNext() ) {
+      QFileInfo file(it.next());
+      QString dir = outDir.isEmpty() ? file.path() : QDir(outDir).filePath(root.relativeFilePath(file.path()));
+      jobs.append(qMakePair(file.filePath(), QDir(dir).filePath(file.completeBaseName() + "." + ext)));
+      }
+    }
+  else {
+    QString dir = outDir.isEmpty() ? info.path() : outDir;
+    jobs.append(qMakePair(path, QDir(dir).filePath(info.completeBaseName() + "." + ext)));
+    }
+}
+
+// Makes sure that no job overwrites its input and that no two jobs write the same file.
+// Inputs listed twice (e.g. a file and its directory) are converted once, files whose output
+// would replace them are skipped and inputs differing only by their extension (a.fsd, a.fsdb)
+// keep it in their output name (a.fsd.dot, a.fsdb.dot), as do those whose output would
+// replace another input
+static bool resolveOutputs(QList<QPair<QString,QString> >& jobs, Command command)
+{
+  QList<QPair<QString,QString> > res;
+  QSet<QString> inputs;
+  QHash<QString,int> outputs;  // Number of jobs per output
+  for ( const auto& job: jobs ) {
+    QString input = QFileInfo(job.first).absoluteFilePath();
+    if ( inputs.contains(input) ) continue;
+    inputs.insert(input);
+    if ( QFileInfo(job.second).absoluteFilePath() == input ) {
+      error(job.first + ": already in the output format, skipped");
+      continue;
+      }
+    res.append(job);
+    outputs[QFileInfo(job.second).absoluteFilePath()]++;
+    }
+  QSet<QString> written;
+  for ( auto& job: res ) {
+    QFileInfo output(job.second);
+    if ( outputs.value(output.absoluteFilePath()) > 1 || inputs.contains(output.absoluteFilePath()) )
+      job.second = QDir(output.path()).filePath(QFileInfo(job.first).fileName() + "." + extension(command));
+    QString fname = QFileInfo(job.second).absoluteFilePath();
+    if ( written.contains(fname) || inputs.contains(fname) ) {
+      error(job.second + ": written by several jobs or also an input");
+      return false;
+      }
+    written.insert(fname);
+    }
+  jobs = res;
+  return true;
+}
+
+static bool readList(const QString& fname, QStringList& paths)
+{
+  QFile file;
+  bool opened;
+  if ( fname == "-" )
+    opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+  else {
+    file.setFileName(fname);
+    opened = file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+  if ( ! opened ) return false;
+  QTextStream is(&file);
+  while ( ! is.atEnd() ) {
+    QString line = is.readLine().trimmed();
+    if ( ! line.isEmpty() ) paths.append(line);
+    }
+  return true;
+}
+
+static int runBatch(Command command, const QStringList& paths, const QString& outDir, bool compact, int nbThreads)
+{
+  QList<QPair<QString,QString> > jobs;
+  for ( const auto& path: paths ) {
+    if ( ! QFileInfo::exists(path) ) return error(path + ": no such file or directory");
+    collectJobs(path, outDir, command, jobs);
+    }
+  if ( ! resolveOutputs(jobs, command) ) return 1;
+  // Output directories are created beforehand, so that jobs only touch their own files
+  QSet<QString> dirs;
+  for ( const auto& job: jobs ) dirs.insert(QFileInfo(job.second).path());
+  for ( const auto& dir: dirs )
+    if ( ! QDir().mkpath(dir) ) return error(dir + ": cannot create directory");
+
+  QElapsedTimer timer;
+  timer.start();
+  BatchReport report;
+  QThreadPool pool;
+  if ( nbThreads > 0 ) pool.setMaxThreadCount(nbThreads);
+  for ( const auto& job: jobs )
+    pool.start(new BatchJob(command, compact, job.first, job.second, &report));
+  pool.waitForDone();
+
+  printf("%d file(s), %d failure(s), %.3f s on %d thread(s)\n",
+         jobs.count(), report.failures(), timer.nsecsElapsed() / 1e9, pool.maxThreadCount());
+  return report.failures() > 0 ? 1 : 0;
+}
+
+// Export benchmark
+
+// Counts and discards everything written to it
+class NullDevice : public QIODevice
+{
+public:
+  NullDevice() : written(0) { open(QIODevice::WriteOnly); }
+  qint64 written;
+
+protected:
+  qint64 readData(char *, qint64) override { return -1; }
+  qint64 writeData(const char *, qint64 len) override { written += len; return len; }
+};
+
+// About ten transitions per state, with a limited set of (shared) labels, as in real diagrams
+static Graph generateGraph(int nbTransitions)
+{
+  Graph graph;
+  int nbStates = qMax(1, nbTransitions / 10);
+  graph.reserve(nbStates + 1, nbTransitions + 1);
+  for ( int i=0; i<nbStates; i++ )
+    graph.addNode("S" + QString::number(i), (i % 100) * 120.0, (i / 100) * 120.0);
+  int init = graph.addNode(Graph::initPseudoId, -60.0, 0.0);
+  graph.addEdge(init, 0, "", Graph::None);
+  for ( int i=0; i<nbTransitions; i++ ) {
+    int src = i % nbStates;
+    int dst = (int)(((qint64)i * 7919 + 1) % nbStates);
+    QString label = "e" + QString::number(i % 100) + "/a" + QString::number(i % 37);
+    graph.addEdge(src, dst, label, src == dst ? Graph::North : Graph::None);
+    }
+  return graph;
+}
+
+// Describes [graph] independently of the order of its states and transitions
+static QStringList canonical(const Graph& graph)
+{
+  QStringList res;
+  for ( int n=0; n<graph.nodes().count(); n++ ) {
+    const Graph::Node& node = graph.nodes()[n];
+    res << QString("state %1 %2 %3 %4").arg(graph.nodeId(n)).arg(node.pseudo)
+                                        .arg(node.x, 0, 'g', 17).arg(node.y, 0, 'g', 17);
+    }
+  for ( int e=0; e<graph.edges().count(); e++ ) {
+    const Graph::Edge& edge = graph.edges()[e];
+    res << QString("transition %1 %2 %3 %4").arg(graph.nodeId(edge.src)).arg(graph.nodeId(edge.dst))
+                                             .arg(edge.location).arg(graph.edgeLabel(e));
+    }
+  res.sort();
+  return res;
+}
+
+// Memory usage of the process, in bytes, as reported by Linux for [field] (VmRSS, VmHWM, ...),
+// or -1 if not available
+static qint64 memoryUsage(const char *field)
+{
+  QFile file("/proc/self/status");
+  if ( ! file.open(QIODevice::ReadOnly | QIODevice::Text) ) return -1;
+  for ( const QByteArray& line: file.readAll().split('\n') )
+    if ( line.startsWith(field) )
+      return line.mid(strlen(field)).trimmed().split(' ').first().toLongLong() * 1024;
+  return -1;
+}
+
+// Resets the peak memory usage (VmHWM) to the current one
+static void resetPeakMemoryUsage()
+{
+  QFile file("/proc/self/clear_refs");
+  if ( file.open(QIODevice::WriteOnly) ) file.write("5");
+}
+
+// .fsd loading as it was before the streaming loader: a full DOM, whose elements are copied
+// by value, and a map from ids to states
+static void loadWithDom(const QByteArray& bytes, Graph& graph)
+{
+  auto json = nlohmann::json::parse(bytes.toStdString());
+  QMap<std::string,int> nodes;
+  for ( auto json_state : json.at("states") ) {
+    std::string id = json_state.at("id");
+    nodes.insert(id, graph.addNode(QString::fromStdString(id), json_state.at("x"), json_state.at("y")));
+    }
+  for ( auto json_transition : json.at("transitions") ) {
+    std::string src_state = json_transition.at("src_state");
+    std::string dst_state = json_transition.at("dst_state");
+    std::string label = json_transition.at("label");
+    if ( ! nodes.contains(src_state) || ! nodes.contains(dst_state) )
+      throw std::invalid_argument("invalid state id");
+    graph.addEdge(nodes.value(src_state), nodes.value(dst_state), QString::fromStdString(label),
+                  Graph::Location((int)json_transition.at("location")));
+    }
+}
+
+// Opening of generated .fsd files of about 1, 10 and 100 MB: mapped in memory and parsed in
+// place, or read and decoded into a QString, then encoded back to UTF-8, as before
+static bool runOpenBenchmark(int nbTransitions, qint64 size)
+{
+  bool ok = true;
+  const qint64 targets[] = { 1000000, 10000000, 100000000 };
+  for ( qint64 target: targets ) {
+    Graph graph = generateGraph((int)(nbTransitions * target / size));
+    QTemporaryFile file;
+    if ( ! file.open() || ! graph.toJson(&file) || ! file.flush() ) {
+      error(file.fileName() + ": cannot write");
+      return false;
+      }
+    QElapsedTimer timer;
+    timer.start();
+    Graph mapped;
+    mapped.load(file.fileName());
+    qint64 mapNsecs = timer.nsecsElapsed();
+    timer.restart();
+    Graph read;
+    QFile in(file.fileName());
+    if ( ! in.open(QIODevice::ReadOnly | QIODevice::Text) ) return false;
+    QTextStream is(&in);
+    QString text = is.readAll();
+    QByteArray bytes = text.toUtf8();
+    read.fromJson(bytes.constData(), bytes.size());
+    qint64 readNsecs = timer.nsecsElapsed();
+    bool same = mapped.structuralHash() == graph.structuralHash() && read.structuralHash() == graph.structuralHash();
+    ok = ok && same;
+    printf("open %6.1f MB %10.3f ms mapped %10.3f ms read as text  %s\n",
+           file.size() / 1e6, mapNsecs / 1e6, readNsecs / 1e6, same ? "ok" : "FAILED");
+    }
+  return ok;
+}
+
+// Startup to exit of the command line mode, on a small diagram, run as a CI pipeline would
+static bool runStartupBenchmark(const char *program)
+{
+  QTemporaryFile file(QDir::tempPath() + "/ssde_XXXXXX.fsd");
+  if ( ! file.open() || ! generateGraph(100).toJson(&file) || ! file.flush() ) {
+    error(file.fileName() + ": cannot write");
+    return false;
+    }
+  const char *commands[] = { "--stats", "--to-dot" };
+  const int nbRuns = 20;
+  bool ok = true;
+  for ( const char *command: commands ) {
+    QElapsedTimer timer;
+    timer.start();
+    for ( int i=0; i<nbRuns && ok; i++ ) {
+      QProcess process;
+      process.setStandardOutputFile(QProcess::nullDevice());
+      process.start(QString::fromLocal8Bit(program), QStringList() << command << file.fileName());
+      ok = process.waitForFinished() && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+      }
+    if ( ! ok ) {
+      error(QString(program) + " " + command + ": failed");
+      return false;
+      }
+    printf("%-22s %10.3f ms per run (startup to exit)\n", command, timer.nsecsElapsed() / 1e6 / nbRuns);
+    }
+  return true;
+}
+
+// The DOM the .fsd writer replaces
+static nlohmann::json toDom(const Graph& graph)
+{
+  nlohmann::json dom;
+  dom["states"] = nlohmann::json::array();
+  for ( int n=0; n<graph.nodes().count(); n++ )
+    dom["states"].push_back({
+      { "id", graph.nodeId(n).toStdString() },
+      { "x", graph.nodes()[n].x },
+      { "y", graph.nodes()[n].y } });
+  dom["transitions"] = nlohmann::json::array();
+  for ( int e=0; e<graph.edges().count(); e++ )
+    dom["transitions"].push_back({
+      { "src_state", graph.nodeId(graph.edges()[e].src).toStdString() },
+      { "dst_state", graph.nodeId(graph.edges()[e].dst).toStdString() },
+      { "label", graph.edgeLabel(e).toStdString() },
+      { "location", (int)graph.edges()[e].location } });
+  return dom;
+}
+
+// [input] is either a file name or a number of transitions
+static int runExportBenchmark(const QString& input, const char *program)
+{
+  Graph graph;
+  bool generated;
+  int nbTransitions = input.toInt(&generated);
+  if ( generated && nbTransitions <= 0 ) { fputs(usage, stderr); return 2; }
+  try {
+    if ( generated )
+      graph = generateGraph(nbTransitions);
+    else
+      graph.load(input);
+  }
+  catch ( const std::exception& e ) {
+    return error(input + ": " + e.what());
+  }
+  printf("%d states, %d transitions\n", graph.nodes().count(), graph.edges().count());
+  auto report = [](const char *name, qint64 nsecs, qint64 bytes) {
+    double ms = nsecs / 1e6;
+    printf("%-22s %10.3f ms %10.2f MB %10.1f MB/s\n", name, ms, bytes / 1e6, ms > 0 ? bytes / 1e3 / ms : 0.0);
+  };
+  auto run = [&](const char *name, std::function<bool(QIODevice*)> f) {
+    NullDevice device;
+    QElapsedTimer timer;
+    timer.start();
+    f(&device);
+    report(name, timer.nsecsElapsed(), device.written);
+  };
+  run("dot", [&](QIODevice *d) { DotSink sink(d); return exportGraph(graph, sink); });
+  run("json", [&](QIODevice *d) { JsonSink sink(d, false); return exportGraph(graph, sink); });
+  run("json (compact)", [&](QIODevice *d) { JsonSink sink(d, true); return exportGraph(graph, sink); });
+  run("fsdb", [&](QIODevice *d) { return graph.toBinary(d); });
+  run("scxml", [&](QIODevice *d) { return graph.toScxml(d); });
+  // The three text formats in a single traversal
+  NullDevice d1, d2, d3;
+  DotSink dot(&d1);
+  JsonSink json(&d2, false), compact(&d3, true);
+  QElapsedTimer timer;
+  timer.start();
+  exportGraph(graph, QList<ExportSink*>() << &dot << &json << &compact);
+  report("dot+json+compact", timer.nsecsElapsed(), d1.written + d2.written + d3.written);
+
+  // The .fsd writer against the DOM it replaces
+  bool ok = true;
+  nlohmann::json dom = toDom(graph);
+  auto jsonOutput = [&](bool compact) {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    graph.toJson(&buffer, compact);
+    return buffer.data().toStdString();
+  };
+  bool identical = jsonOutput(false) == dom.dump(2) && jsonOutput(true) == dom.dump();
+  ok = ok && identical;
+  printf("json output %s nlohmann::json::dump\n", identical ? "identical to" : "DIFFERS from");
+
+  // Saving to a file, and reading it back: the structure (structural hash) and the
+  // positions and locations (canonical description) must be preserved
+  printf("\n");
+  auto load = [&](const char *name, std::function<bool(QIODevice*)> save) {
+    QTemporaryFile file;
+    if ( ! file.open() || ! save(&file) || ! file.flush() ) {
+      error(file.fileName() + ": cannot write");
+      ok = false;
+      return;
+      }
+    Graph copy;
+    QElapsedTimer timer;
+    timer.start();
+    try {
+      copy.load(file.fileName());
+    }
+    catch ( const std::exception& e ) {
+      error(QString(name) + ": " + e.what());
+      ok = false;
+      return;
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+    const char *res = copy.structuralHash() != graph.structuralHash() ? "FAILED (structure)"
+                    : canonical(copy) != canonical(graph) ? "FAILED (positions)" : "ok";
+    ok = ok && strcmp(res, "ok") == 0;
+    printf("%-22s %10.3f ms %10.2f MB %10.1f MB/s  round trip %s\n", name, nsecs / 1e6, file.size() / 1e6,
+           nsecs > 0 ? file.size() / 1e3 / (nsecs / 1e6) : 0.0, res);
+  };
+  load("load json", [&](QIODevice *d) { return graph.toJson(d); });
+  load("load fsdb", [&](QIODevice *d) { return graph.toBinary(d); });
+  load("load scxml", [&](QIODevice *d) { return graph.toScxml(d); });
+
+  // .fsd loading, streamed and through a DOM, with the peak memory used by each
+  printf("\n");
+  QByteArray fsd;
+  QBuffer buffer(&fsd);
+  buffer.open(QIODevice::WriteOnly);
+  graph.toJson(&buffer);
+  auto measure = [&](const char *name, std::function<void(Graph&)> f) {
+    qint64 base = memoryUsage("VmRSS:");
+    resetPeakMemoryUsage();
+    Graph copy;
+    QElapsedTimer timer;
+    timer.start();
+    f(copy);
+    qint64 nsecs = timer.nsecsElapsed();
+    qint64 peak = memoryUsage("VmHWM:");
+    bool same = copy.structuralHash() == graph.structuralHash();
+    ok = ok && same;
+    if ( base >= 0 && peak >= base )
+      printf("%-22s %10.3f ms %10.2f MB  peak +%.2f MB  %s\n", name, nsecs / 1e6, fsd.size() / 1e6,
+             (peak - base) / 1e6, same ? "ok" : "FAILED");
+    else
+      printf("%-22s %10.3f ms %10.2f MB  %s\n", name, nsecs / 1e6, fsd.size() / 1e6, same ? "ok" : "FAILED");
+  };
+  measure("load fsd (streamed)", [&](Graph& g) { g.fromJson(fsd.constData(), fsd.size()); });
+  measure("load fsd (dom)", [&](Graph& g) { loadWithDom(fsd, g); });
+
+  printf("\n");
+  ok = runOpenBenchmark(qMax(1, graph.edges().count()), fsd.size()) && ok;
+  printf("\n");
+  ok = runStartupBenchmark(program) && ok;
+  return ok ? 0 : 1;
+}
+
+// Scene benchmark
+
+// The model is a QGraphicsScene, which requires an application object. The offscreen
+// platform avoids any connection to a display server
+static void useOffscreenPlatform()
+{
+  if ( qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") )
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+}
+
+static int runSceneBenchmark(int argc, char *argv[])
+{
+  SceneBench::Options options;
+  QString output;
+  for ( int i=2; i<argc; i++ ) {
+    if ( strcmp(argv[i], "--input") == 0 && i+1 < argc ) options.input = QString::fromLocal8Bit(argv[++i]);
+    else if ( strcmp(argv[i], "--states") == 0 && i+1 < argc ) options.nbStates = atoi(argv[++i]);
+    else if ( strcmp(argv[i], "--density") == 0 && i+1 < argc ) options.density = atof(argv[++i]);
+    else if ( strcmp(argv[i], "--long") == 0 && i+1 < argc ) options.longEdges = atof(argv[++i]);
+    else if ( strcmp(argv[i], "--steps") == 0 && i+1 < argc ) options.nbSteps = atoi(argv[++i]);
+    else if ( strcmp(argv[i], "-o") == 0 && i+1 < argc ) output = QString::fromLocal8Bit(argv[++i]);
+    else { fputs(usage, stderr); return 2; }
+    }
+  if ( options.nbStates <= 0 || options.density < 0 || options.longEdges < 0 || options.longEdges > 1
+       || options.nbSteps <= 0 ) {
+    fputs(usage, stderr);
+    return 2;
+    }
+
+  useOffscreenPlatform();
+  QApplication app(argc, argv);
+  QByteArray results;
+  try {
+    results = SceneBench::run(options);
+  }
+  catch ( const std::exception& e ) {
+    return error((options.input.isEmpty() ? QString("--bench-scene") : options.input) + ": " + e.what());
+  }
+
+  QFile file;
+  bool opened;
+  if ( output.isEmpty() )
+    opened = file.open(stdout, QIODevice::WriteOnly);
+  else {
+    file.setFileName(output);
+    opened = file.open(QIODevice::WriteOnly | QIODevice::Text);
+    }
+  if ( ! opened ) return error(output + ": " + file.errorString());
+  if ( file.write(results) != results.size() ) return error((output.isEmpty() ? QString("<stdout>") : output) + ": write error");
+  return 0;
+}
+
+int runCommandLine(int argc, char *argv[])
+{
+  if ( strcmp(argv[1], "--bench-export") == 0 )
+    return runExportBenchmark(argc > 2 ? QString::fromLocal8Bit(argv[2]) : QString("100000"), argv[0]);
+  if ( strcmp(argv[1], "--bench-scene") == 0 )
+    return runSceneBenchmark(argc, argv);
+  if ( strcmp(argv[1], "--bench-render") == 0 || strcmp(argv[1], "--bench-drag") == 0 ) {
+    error(QString(argv[1]) + " has been replaced by --bench-scene");
+    fputs(usage, stderr);
+    return 2;
+    }
+
+  Command command = NoCommand;
+  QString input, output;
+  QStringList paths;
+  bool compact = false;
+  bool batch = false;
+  int nbThreads = 0;
+
+  for ( int i=1; i<argc; i++ ) {
+    Command c = NoCommand;
+    if ( strcmp(argv[i], "--to-dot") == 0 ) c = ToDot;
+    else if ( strcmp(argv[i], "--to-json") == 0 ) c = ToJson;
+    else if ( strcmp(argv[i], "--to-fsdb") == 0 ) c = ToFsdb;
+    else if ( strcmp(argv[i], "--to-scxml") == 0 ) c = ToScxml;
+    else if ( strcmp(argv[i], "--stats") == 0 ) c = Stats;
+    else if ( strcmp(argv[i], "--compact") == 0 ) { compact = true; continue; }
+    else if ( strcmp(argv[i], "--batch") == 0 ) { batch = true; continue; }
+    else if ( strcmp(argv[i], "-o") == 0 && i+1 < argc ) { output = QString::fromLocal8Bit(argv[++i]); continue; }
+    else if ( strcmp(argv[i], "-j") == 0 && i+1 < argc ) { nbThreads = atoi(argv[++i]); continue; }
+    else if ( strcmp(argv[i], "--files-from") == 0 && i+1 < argc ) {
+      QString list = QString::fromLocal8Bit(argv[++i]);
+      if ( ! readList(list, paths) ) return error(list + ": cannot read file list");
+      continue;
+      }
+    else if ( strcmp(argv[i], "--help") == 0 ) { fputs(usage, stdout); return 0; }
+    else if ( argv[i][0] != '-' ) { paths.append(QString::fromLocal8Bit(argv[i])); continue; }
+    else { fputs(usage, stderr); return 2; }
+    if ( command != NoCommand ) { fputs(usage, stderr); return 2; }
+    command = c;
+    }
+  if ( batch ) {
+    if ( command == NoCommand || command == Stats || paths.isEmpty() ) {
+      fputs(usage, stderr);
+      return 2;
+      }
+    return runBatch(command, paths, output, compact, nbThreads);
+    }
+  if ( command == NoCommand || paths.count() != 1 || (command == ToFsdb && output.isEmpty()) ) {
+    fputs(usage, stderr);
+    return 2;
+    }
+  input = paths.first();
+
+  // No application object is needed : the graph core only relies on QtCore classes
+  Graph graph;
+  try {
+    graph.load(input);
+  }
+  catch ( const std::exception& e ) {
+    return error(input + ": " + e.what());
+  }
+
+  if ( command == Stats ) {
+    printStats(graph);
+    return 0;
+    }
+
+  QFile file;
+  bool opened;
+  if ( output.isEmpty() )
+    opened = file.open(stdout, QIODevice::WriteOnly);
+  else {
+    file.setFileName(output);
+    opened = file.open(command == ToFsdb ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text);
+    }
+  if ( ! opened ) return error(output + ": " + file.errorString());
+
+  if ( ! write(graph, command, &file, compact) ) return error((output.isEmpty() ? QString("<stdout>") : output) + ": write error");
+  return 0;
+}
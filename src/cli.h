@@ -0,0 +1,22 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef CLI_H
+#define CLI_H
+
+// Headless (command-line) mode, for batch conversions and benchmarks.
+// No window is shown and no display connection is opened.
+
+bool isCommandLineMode(int argc, char *argv[]);
+int runCommandLine(int argc, char *argv[]);
+
+#endif // CLI_H
@@ -0,0 +1,234 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "dotlayout.h"
+#include "graph.h"
+#include "exporter.h"
+#include "qt_compat.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <stdexcept>
+#include <gvc.h>
+#include <cgraph.h>
+
+// graphviz keeps global state and is not reentrant, so layouts are serialized
+static QMutex graphvizLock;
+static GVC_t *context = NULL;
+
+static void setAttribute(void *obj, const char *name, const QString& value)
+{
+  QByteArray v = value.toUtf8();
+  agsafeset(obj, const_cast<char *>(name), v.data(), const_cast<char *>(""));
+}
+
+static const qreal dpi = 72.0;  // graphviz sizes are in inches, positions in points
+
+// Any change to the way graphs are laid out must be reflected in [key], hence these tables
+static const char *graphAttributes[][2] = {
+  { "rankdir", "UD" },
+  { "nodesep", "0.55" },
+  { "ranksep", "0.95" },
+  { "fontsize", "14" },
+  { "mindist", "1.0" }
+};
+static const char *nodeAttributes[][2] = {
+  { "shape", "circle" },
+  { "style", "solid" }
+};
+static const char *pseudoStateShape = "point";
+static const char *labelPadding = "  ";
+static const quint32 keyVersion = 2;  // To be bumped when the contents of a layout change
+
+static QString edgeLabel(const GraphView& graph, int e)
+{
+  return graph.isInitial(e) ? QString() : Graph::dotLabel(graph.edgeLabel(e), labelPadding);
+}
+
+// Feeds everything graphviz is given to a hash
+
+class KeySink : public ExportSink
+{
+public:
+  KeySink() : h(QCryptographicHash::Sha1) { }
+
+  void begin(const GraphView& graph) override
+  {
+    addInt(keyVersion);
+    for ( const auto& attr: graphAttributes ) { addString(attr[0]); addString(attr[1]); }
+    for ( const auto& attr: nodeAttributes ) { addString(attr[0]); addString(attr[1]); }
+    addString(pseudoStateShape);
+    addInt(graph.nbNodes());
+    addInt(graph.nbEdges());
+  }
+
+  void node(const GraphView& graph, int n) override
+  {
+    addInt(graph.isPseudo(n));
+    addString(graph.isPseudo(n) ? QString() : graph.nodeId(n));
+  }
+
+  void edge(const GraphView& graph, int e) override
+  {
+    addInt(graph.edgeSrc(e));
+    addInt(graph.edgeDst(e));
+    addString(edgeLabel(graph, e));
+  }
+
+  QByteArray result() const { return h.result(); }
+
+private:
+  QCryptographicHash h;
+
+  void addInt(quint32 v) { HASH_ADD_DATA(h, (const char *)&v, sizeof(v)); }
+  void addString(const QString& s) { QByteArray b = s.toUtf8(); addInt(b.size()); h.addData(b); }
+};
+
+// Builds the graphviz graph. Nodes are named after their index, since ids may not be unique
+// while editing
+
+class CGraphSink : public ExportSink
+{
+public:
+  Agraph_t *g;
+  QVector<Agnode_t *> nodes;
+  QVector<Agedge_t *> edges;
+
+  void begin(const GraphView& graph) override
+  {
+    g = agopen(const_cast<char *>("main"), Agdirected, NULL);
+    for ( const auto& attr: graphAttributes )
+      setAttribute(g, attr[0], attr[1]);
+    for ( const auto& attr: nodeAttributes )
+      agattr(g, AGNODE, const_cast<char *>(attr[0]), const_cast<char *>(attr[1]));
+    nodes.resize(graph.nbNodes());
+    edges.resize(graph.nbEdges());
+  }
+
+  void node(const GraphView& graph, int n) override
+  {
+    QByteArray name = QByteArray::number(n);
+    nodes[n] = agnode(g, name.data(), 1);
+    if ( graph.isPseudo(n) )
+      setAttribute(nodes[n], "shape", pseudoStateShape);
+    else
+      setAttribute(nodes[n], "label", graph.nodeId(n));
+  }
+
+  void edge(const GraphView& graph, int e) override
+  {
+    edges[e] = agedge(g, nodes[graph.edgeSrc(e)], nodes[graph.edgeDst(e)], NULL, 1);
+    if ( ! graph.isInitial(e) )
+      setAttribute(edges[e], "label", edgeLabel(graph, e));
+  }
+};
+
+QByteArray DotLayout::key(const Graph& graph)
+{
+  KeySink sink;
+  exportGraph(graph, sink);
+  return sink.result();
+}
+
+DotLayout DotLayout::compute(const Graph& graph)
+{
+  QMutexLocker lock(&graphvizLock);
+  if ( context == NULL ) context = gvContext();
+
+  CGraphSink sink;
+  exportGraph(graph, sink);
+  Agraph_t *g = sink.g;
+  const QVector<Agnode_t *>& nodes = sink.nodes;
+  const QVector<Agedge_t *>& edges = sink.edges;
+
+  if ( gvLayout(context, g, "dot") != 0 ) {
+    agclose(g);
+    throw std::runtime_error("graphviz layout failed");
+    }
+
+  DotLayout layout;
+  boxf bb = GD_bb(g);
+  qreal top = bb.UR.y;
+  auto toScene = [top](pointf p) { return QPointF(p.x, top - p.y); };
+  layout.boundingRect = QRectF(QPointF(bb.LL.x, 0), QPointF(bb.UR.x, bb.UR.y - bb.LL.y));
+
+  layout.nodes.resize(nodes.count());
+  for ( int n=0; n<nodes.count(); n++ ) {
+    Node& node = layout.nodes[n];
+    qreal w = ND_width(nodes[n]) * dpi;
+    qreal h = ND_height(nodes[n]) * dpi;
+    QPointF c = toScene(ND_coord(nodes[n]));
+    node.rect = QRectF(c.x() - w/2, c.y() - h/2, w, h);
+    node.pseudo = graph.nodes()[n].pseudo;
+    node.label = node.pseudo ? QString() : graph.nodeId(n);
+    }
+
+  layout.edges.resize(edges.count());
+  for ( int e=0; e<edges.count(); e++ ) {
+    Edge& edge = layout.edges[e];
+    edge.src = graph.edges()[e].src;
+    edge.dst = graph.edges()[e].dst;
+    edge.hasArrow = false;
+    splines *spl = ED_spl(edges[e]);
+    if ( spl != NULL && spl->size > 0 ) {
+      const bezier& bz = spl->list[0];
+      for ( int i=0; i<bz.size; i++ )
+        edge.spline.append(toScene(bz.list[i]));
+      if ( bz.eflag ) {
+        edge.hasArrow = true;
+        edge.arrowTip = toScene(bz.ep);
+        }
+      }
+    textlabel_t *label = ED_label(edges[e]);
+    if ( label != NULL && label->set ) {
+      edge.label = QString::fromUtf8(label->text);
+      edge.labelPos = toScene(label->pos);
+      }
+    }
+
+  gvFreeLayout(context, g);
+  agclose(g);
+  return layout;
+}
+
+// Serialization, for the layout cache
+
+QDataStream& operator<<(QDataStream& os, const DotLayout& layout)
+{
+  os << layout.boundingRect << (quint32)layout.nodes.count();
+  for ( const auto& node: layout.nodes )
+    os << node.label << node.pseudo << node.rect;
+  os << (quint32)layout.edges.count();
+  for ( const auto& edge: layout.edges )
+    os << (qint32)edge.src << (qint32)edge.dst << edge.spline << edge.hasArrow << edge.arrowTip << edge.label << edge.labelPos;
+  return os;
+}
+
+QDataStream& operator>>(QDataStream& is, DotLayout& layout)
+{
+  quint32 nbNodes, nbEdges;
+  is >> layout.boundingRect >> nbNodes;
+  layout.nodes.resize(nbNodes);
+  for ( auto& node: layout.nodes )
+    is >> node.label >> node.pseudo >> node.rect;
+  is >> nbEdges;
+  layout.edges.resize(nbEdges);
+  for ( auto& edge: layout.edges ) {
+    qint32 src, dst;
+    is >> src >> dst >> edge.spline >> edge.hasArrow >> edge.arrowTip >> edge.label >> edge.labelPos;
+    edge.src = src;
+    edge.dst = dst;
+    }
+  return is;
+}
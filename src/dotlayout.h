@@ -0,0 +1,67 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef DOTLAYOUT_H
+#define DOTLAYOUT_H
+
+#include <QVector>
+#include <QString>
+#include <QPointF>
+#include <QRectF>
+#include <QMetaType>
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QDataStream;
+QT_END_NAMESPACE
+
+class Graph;
+
+// The result of laying out a graph with the graphviz [dot] engine, in scene coordinates
+// (y axis pointing downwards). It is plain data, so that it can be computed on a worker thread
+// and turned into graphics items afterwards.
+
+class DotLayout
+{
+public:
+    struct Node {
+      QString label;
+      bool pseudo;
+      QRectF rect;
+    };
+
+    struct Edge {
+      int src, dst;             // Node indices
+      QVector<QPointF> spline;  // Cubic Bezier : start point followed by 3 points per segment
+      bool hasArrow;
+      QPointF arrowTip;
+      QString label;
+      QPointF labelPos;         // Center of the label
+    };
+
+    QRectF boundingRect;
+    QVector<Node> nodes;
+    QVector<Edge> edges;
+
+    // Throws std::runtime_error if graphviz fails. Can be called from any thread
+    static DotLayout compute(const Graph& graph);
+
+    // Identifies the layout of [graph] : graphs with the same key have the same layout
+    static QByteArray key(const Graph& graph);
+};
+
+QDataStream& operator<<(QDataStream& os, const DotLayout& layout);
+QDataStream& operator>>(QDataStream& is, DotLayout& layout);
+
+Q_DECLARE_METATYPE(DotLayout)
+
+#endif // DOTLAYOUT_H
@@ -0,0 +1,220 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "dotrenderer.h"
+#include "graph.h"
+#include "layoutcache.h"
+
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QGraphicsView>
+#include <QGraphicsScene>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsPathItem>
+#include <QGraphicsPolygonItem>
+#include <QGraphicsSimpleTextItem>
+#include <QPainterPath>
+#include <QLineF>
+#include <QtMath>
+#include <stdexcept>
+
+// The job owns its own copy of the graph, so that the model can be edited while it runs.
+// graphviz is only called when the layout is not found in the cache
+
+class DotRenderer::LayoutJob : public QRunnable
+{
+public:
+  LayoutJob(DotRenderer *renderer, int generation, const Graph& graph)
+    : renderer(renderer), generation(generation), graph(graph) { }
+
+  void run() override
+  {
+    DotLayout layout;
+    QString error;
+    try {
+      QByteArray key = DotLayout::key(graph);
+      if ( ! renderer->cache->find(key, layout) ) {
+        layout = DotLayout::compute(graph);
+        renderer->cache->insert(key, layout);
+        }
+    }
+    catch ( const std::exception& e ) {
+      error = e.what();
+    }
+    emit renderer->layoutReady(generation, layout, error);
+  }
+
+private:
+  DotRenderer *renderer;
+  int generation;
+  Graph graph;
+};
+
+DotRenderer::DotRenderer(QGraphicsView *view, QObject *parent)
+  : QObject(parent), view(view), generation(0), busy(false), requestedHash(0)
+{
+  qRegisterMetaType<DotLayout>();
+  cache = new LayoutCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/layouts");
+  scene = new QGraphicsScene(this);
+  view->setScene(scene);
+  pool.setMaxThreadCount(1);
+  connect(this, SIGNAL(layoutReady(int,DotLayout,QString)),
+          this, SLOT(layoutDone(int,DotLayout,QString)), Qt::QueuedConnection);
+}
+
+DotRenderer::~DotRenderer()
+{
+  pool.clear();
+  pool.waitForDone();
+  delete cache;
+}
+
+void DotRenderer::render(const Graph& graph)
+{
+  // The scene already shows (or will show) the layout of a structurally identical graph
+  quint64 hash = graph.structuralHash();
+  if ( hash == requestedHash ) return;
+  requestedHash = hash;
+  generation++;
+  pool.clear();  // Drops the pending (superseded) layouts
+  pool.start(new LayoutJob(this, generation, graph));
+  if ( ! busy ) {
+    busy = true;
+    emit started();
+    }
+}
+
+void DotRenderer::layoutDone(int generation, const DotLayout& layout, const QString& error)
+{
+  if ( generation != this->generation ) return;  // Stale
+  busy = false;
+  if ( error.isEmpty() ) {
+    updateScene(layout);
+    emit finished();
+    }
+  else {
+    requestedHash = 0;  // Allows retrying
+    emit finished();
+    emit failed(error);
+    }
+}
+
+static QPolygonF arrowHead(QPointF from, QPointF tip)
+{
+  const qreal size = 10;
+  QLineF line(tip, from);
+  if ( line.length() == 0 ) return QPolygonF();
+  qreal angle = qAtan2(-line.dy(), line.dx());
+  QPointF p1 = tip + QPointF(qCos(angle + M_PI/6) * size, -qSin(angle + M_PI/6) * size);
+  QPointF p2 = tip + QPointF(qCos(angle - M_PI/6) * size, -qSin(angle - M_PI/6) * size);
+  return QPolygonF() << tip << p1 << p2;
+}
+
+// Items are matched across renderings by the labels of the nodes (and edge ends), so that only
+// the items of added or removed nodes and edges are created or deleted. The others are updated
+// in place, which Qt turns into a no-op when their geometry has not changed
+
+static void setText(QGraphicsSimpleTextItem *item, const QString& text, QPointF center)
+{
+  if ( item->text() != text ) item->setText(text);
+  item->setPos(center - item->boundingRect().center());
+}
+
+static QPainterPath splinePath(const QVector<QPointF>& spline)
+{
+  QPainterPath path(spline.first());
+  for ( int i=1; i+2<spline.count(); i+=3 )
+    path.cubicTo(spline[i], spline[i+1], spline[i+2]);
+  return path;
+}
+
+static QVector<QString> itemKeys(const QVector<QString>& names)
+{
+  QVector<QString> keys(names.count());
+  QHash<QString,int> occurrences;
+  for ( int i=0; i<names.count(); i++ ) {
+    int k = occurrences[names[i]]++;
+    keys[i] = k == 0 ? names[i] : names[i] + '#' + QString::number(k);
+    }
+  return keys;
+}
+
+void DotRenderer::updateScene(const DotLayout& layout)
+{
+  QPen pen(Qt::black);
+
+  QVector<QString> names(layout.nodes.count());
+  for ( int n=0; n<layout.nodes.count(); n++ )
+    names[n] = layout.nodes[n].pseudo ? QString("\x01") : "n:" + layout.nodes[n].label;
+  QVector<QString> nodeKeys = itemKeys(names);
+  QHash<QString,NodeItems> nodes;
+  for ( int n=0; n<layout.nodes.count(); n++ ) {
+    const DotLayout::Node& node = layout.nodes[n];
+    NodeItems items = nodeItems.take(nodeKeys[n]);
+    if ( items.shape == NULL )
+      items.shape = scene->addEllipse(node.rect, pen, node.pseudo ? QBrush(Qt::black) : QBrush());
+    else
+      items.shape->setRect(node.rect);
+    if ( ! node.pseudo ) {
+      if ( items.text == NULL ) items.text = scene->addSimpleText(node.label);
+      setText(items.text, node.label, node.rect.center());
+      }
+    nodes.insert(nodeKeys[n], items);
+    }
+  foreach ( const NodeItems& items, nodeItems ) {
+    delete items.shape;
+    delete items.text;
+    }
+  nodeItems = nodes;
+
+  names.resize(layout.edges.count());
+  for ( int e=0; e<layout.edges.count(); e++ ) {
+    const DotLayout::Edge& edge = layout.edges[e];
+    names[e] = nodeKeys[edge.src] + '\x1f' + nodeKeys[edge.dst] + '\x1f' + edge.label;
+    }
+  QVector<QString> edgeKeys = itemKeys(names);
+  QHash<QString,EdgeItems> edges;
+  for ( int e=0; e<layout.edges.count(); e++ ) {
+    const DotLayout::Edge& edge = layout.edges[e];
+    EdgeItems items = edgeItems.take(edgeKeys[e]);
+    QPainterPath path = edge.spline.isEmpty() ? QPainterPath() : splinePath(edge.spline);
+    if ( items.path == NULL )
+      items.path = scene->addPath(path, pen);
+    else
+      items.path->setPath(path);
+    if ( edge.hasArrow && ! edge.spline.isEmpty() ) {
+      QPolygonF arrow = arrowHead(edge.spline.last(), edge.arrowTip);
+      if ( items.arrow == NULL )
+        items.arrow = scene->addPolygon(arrow, pen, QBrush(Qt::black));
+      else
+        items.arrow->setPolygon(arrow);
+      }
+    else {
+      delete items.arrow;
+      items.arrow = NULL;
+      }
+    if ( ! edge.label.isEmpty() ) {
+      if ( items.text == NULL ) items.text = scene->addSimpleText(edge.label);
+      setText(items.text, edge.label, edge.labelPos);
+      }
+    edges.insert(edgeKeys[e], items);
+    }
+  foreach ( const EdgeItems& items, edgeItems ) {
+    delete items.path;
+    delete items.arrow;
+    delete items.text;
+    }
+  edgeItems = edges;
+
+  scene->setSceneRect(layout.boundingRect);
+  view->ensureVisible(layout.boundingRect);
+}
@@ -0,0 +1,87 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef DOTRENDERER_H
+#define DOTRENDERER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QHash>
+#include "dotlayout.h"
+
+QT_BEGIN_NAMESPACE
+class QGraphicsView;
+class QGraphicsScene;
+class QGraphicsEllipseItem;
+class QGraphicsPathItem;
+class QGraphicsPolygonItem;
+class QGraphicsSimpleTextItem;
+QT_END_NAMESPACE
+
+class Graph;
+class LayoutCache;
+
+// Renders graphs in a view, laying them out on a worker thread (or fetching their layout
+// from a persistent cache).
+// Each call to [render] supersedes the previous ones : a layout not started yet is dropped and
+// the result of a layout already running is discarded when it arrives. A graph with the same
+// structure as the previous one is not laid out again.
+
+class DotRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DotRenderer(QGraphicsView *view, QObject *parent = 0);
+    ~DotRenderer();
+
+    void render(const Graph& graph);
+    bool isBusy() const { return busy; }
+
+signals:
+    void started();
+    void finished();
+    void failed(const QString& msg);
+
+    // Emitted from the worker thread, delivered (queued) to [layoutDone]
+    void layoutReady(int generation, const DotLayout& layout, const QString& error);
+
+private slots:
+    void layoutDone(int generation, const DotLayout& layout, const QString& error);
+
+private:
+    class LayoutJob;
+
+    struct NodeItems {
+      QGraphicsEllipseItem *shape = NULL;
+      QGraphicsSimpleTextItem *text = NULL;
+    };
+    struct EdgeItems {
+      QGraphicsPathItem *path = NULL;
+      QGraphicsPolygonItem *arrow = NULL;
+      QGraphicsSimpleTextItem *text = NULL;
+    };
+
+    void updateScene(const DotLayout& layout);
+
+    QGraphicsView *view;
+    QGraphicsScene *scene;
+    QThreadPool pool;
+    LayoutCache *cache;
+    int generation;
+    bool busy;
+    quint64 requestedHash;  // Structural hash of the graph last given to [render]
+    QHash<QString,NodeItems> nodeItems;
+    QHash<QString,EdgeItems> edgeItems;
+};
+
+#endif // DOTRENDERER_H
@@ -0,0 +1,237 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "edgerouter.h"
+#include "state.h"
+#include "transition.h"
+
+#include <QLineF>
+#include <cmath>
+
+qreal EdgeRouter::clearance = 12.0;
+int EdgeRouter::maxDetours = 8;
+
+static const qreal pieceLength = 128;  // Of corridors, half a corridor cell
+
+EdgeRouter::EdgeRouter(const SpatialIndex<State*>& obstacles)
+  : obstacles(obstacles), corridors(256)  // Routes are usually longer than states are wide
+{
+}
+
+QPolygonF EdgeRouter::route(Transition *transition, QPointF from, QPointF to)
+{
+  auto it = routes.find(transition);
+  if ( it != routes.end() && it->valid && it->from == from && it->to == to )
+    return it->waypoints;
+  if ( it == routes.end() ) {
+    it = routes.insert(transition, Route());
+    it->nbPieces = 0;
+    }
+  Route& r = *it;
+  r.from = from;
+  r.to = to;
+  QVector<QLineF> tested;
+  r.waypoints = compute(transition, from, to, tested);
+  r.valid = true;
+  removeCorridor(transition, r);
+  insertCorridor(transition, r, tested);
+  return r.waypoints;
+}
+
+void EdgeRouter::remove(Transition *transition)
+{
+  auto it = routes.find(transition);
+  if ( it == routes.end() ) return;
+  removeCorridor(transition, *it);
+  routes.erase(it);
+}
+
+void EdgeRouter::removeCorridor(Transition *transition, Route& route)
+{
+  for ( int i=0; i<route.nbPieces; i++ )
+    corridors.remove(qMakePair(transition, i));
+  route.nbPieces = 0;
+}
+
+// Cubic Bezier curve [c], split in two halves (de Casteljau)
+static void split(const QPointF c[4], QPointF left[4], QPointF right[4])
+{
+  QPointF p01 = (c[0] + c[1]) / 2, p12 = (c[1] + c[2]) / 2, p23 = (c[2] + c[3]) / 2;
+  QPointF p012 = (p01 + p12) / 2, p123 = (p12 + p23) / 2;
+  QPointF m = (p012 + p123) / 2;
+  left[0] = c[0]; left[1] = p01; left[2] = p012; left[3] = m;
+  right[0] = m; right[1] = p123; right[2] = p23; right[3] = c[3];
+}
+
+// Adds to [pieces] rects covering the curve [c], each one no larger than [pieceLength]
+static void coverCurve(const QPointF c[4], QVector<QRectF>& pieces, int depth = 0)
+{
+  QRectF r = (QPolygonF() << c[0] << c[1] << c[2] << c[3]).boundingRect();
+  if ( depth >= 8 || (r.width() <= pieceLength && r.height() <= pieceLength) ) {
+    pieces.append(r);
+    return;
+    }
+  QPointF left[4], right[4];
+  split(c, left, right);
+  coverCurve(left, pieces, depth + 1);
+  coverCurve(right, pieces, depth + 1);
+}
+
+// The corridor is made of the segments tested while computing the route and, when it goes
+// round states, of the spline drawn through its points (see [spline]), which may overshoot
+// them. Each piece is widened by [clearance]
+void EdgeRouter::insertCorridor(Transition *transition, Route& route, const QVector<QLineF>& tested)
+{
+  QVector<QRectF> pieces;
+  foreach ( const QLineF& segment, tested ) {
+    int n = qMax(1, (int)std::ceil(segment.length() / pieceLength));
+    for ( int i=0; i<n; i++ )
+      pieces.append(QRectF(segment.pointAt((qreal)i / n), segment.pointAt((qreal)(i+1) / n)).normalized());
+    }
+  if ( ! route.waypoints.isEmpty() ) {
+    QPolygonF points;
+    points << route.from << route.waypoints << route.to;
+    int n = points.count();
+    for ( int i=0; i+1<n; i++ ) {
+      QPointF p0 = points.at(qMax(i-1, 0));
+      QPointF p1 = points.at(i);
+      QPointF p2 = points.at(i+1);
+      QPointF p3 = points.at(qMin(i+2, n-1));
+      const QPointF c[4] = { p1, p1 + (p2 - p0) / 6, p2 - (p3 - p1) / 6, p2 };
+      coverCurve(c, pieces);
+      }
+    }
+  for ( int i=0; i<pieces.count(); i++ )
+    corridors.insert(qMakePair(transition, i), pieces.at(i).adjusted(-clearance, -clearance, clearance, clearance));
+  route.nbPieces = pieces.count();
+}
+
+void EdgeRouter::clear()
+{
+  routes.clear();
+  corridors.clear();
+}
+
+void EdgeRouter::invalidate(const QRectF& rect, QSet<Transition*>& res)
+{
+  if ( rect.isNull() ) return;
+  foreach ( const Piece& piece, corridors.intersecting(rect) ) {
+    routes[piece.first].valid = false;
+    res.insert(piece.first);
+    }
+}
+
+// Parameter of the point where [s] enters [r], or -1 if it does not (Liang-Barsky)
+static qreal entry(const QLineF& s, const QRectF& r)
+{
+  const qreal p[4] = { -s.dx(), s.dx(), -s.dy(), s.dy() };
+  const qreal q[4] = { s.x1() - r.left(), r.right() - s.x1(), s.y1() - r.top(), r.bottom() - s.y1() };
+  qreal t0 = 0, t1 = 1;
+  for ( int i=0; i<4; i++ ) {
+    if ( p[i] == 0 ) {
+      if ( q[i] < 0 ) return -1;  // Parallel to this side, and outside
+      continue;
+      }
+    qreal t = q[i] / p[i];
+    if ( p[i] < 0 ) t0 = qMax(t0, t); else t1 = qMin(t1, t);
+    if ( t0 > t1 ) return -1;
+    }
+  return t0;
+}
+
+bool EdgeRouter::findDetour(const Transition *transition, const QLineF& segment, QPointF& waypoint) const
+{
+  QRectF area = QRectF(segment.p1(), segment.p2()).normalized().adjusted(-clearance, -clearance, clearance, clearance);
+  qreal first = 2;
+  QRectF obstacle;
+  foreach ( State *state, obstacles.intersecting(area) ) {
+    if ( state == transition->srcState() || state == transition->dstState() ) continue;
+    QRectF r = obstacles.rect(state).adjusted(-clearance, -clearance, clearance, clearance);
+    if ( r.contains(segment.p1()) || r.contains(segment.p2()) ) continue;  // Cannot be avoided
+    qreal t = entry(segment, r);
+    if ( t >= 0 && t < first ) {
+      first = t;
+      obstacle = r;
+      }
+    }
+  if ( first > 1 ) return false;
+  // Beside the obstacle, on the side of the segment, at [clearance] from it. A waypoint may not
+  // lie within another state, since the segments ending there could then cross it : it is pushed
+  // further, beyond the states in the way, or put on the other side
+  QPointF c = obstacle.center();
+  QPointF n = QPointF(-segment.dy(), segment.dx()) / segment.length();
+  qreal extent = (qAbs(n.x()) * obstacle.width() + qAbs(n.y()) * obstacle.height()) / 2;
+  qreal side = QPointF::dotProduct(c - segment.p1(), n) > 0 ? -1 : 1;
+  for ( int k=0; k<2; k++, side = -side ) {
+    QPointF d = n * side;
+    QPointF p = c + d * (extent + clearance);
+    for ( int i=0; i<maxDetours; i++ ) {
+      QRectF r = blocker(transition, p);
+      if ( r.isNull() ) {
+        waypoint = p;
+        return true;
+        }
+      // Out of [r], along [d]
+      qreal tx = d.x() > 0 ? (r.right() - p.x()) / d.x() : d.x() < 0 ? (r.left() - p.x()) / d.x() : 1e9;
+      qreal ty = d.y() > 0 ? (r.bottom() - p.y()) / d.y() : d.y() < 0 ? (r.top() - p.y()) / d.y() : 1e9;
+      p += d * (qMin(tx, ty) + clearance);
+      }
+    }
+  return false;
+}
+
+// The (widened) rect of a state other than the ends of [transition] containing [p], if any
+QRectF EdgeRouter::blocker(const Transition *transition, QPointF p) const
+{
+  foreach ( State *state, obstacles.intersecting(QRectF(p, p).adjusted(-clearance, -clearance, clearance, clearance)) ) {
+    if ( state == transition->srcState() || state == transition->dstState() ) continue;
+    QRectF r = obstacles.rect(state).adjusted(-clearance, -clearance, clearance, clearance);
+    if ( r.contains(p) ) return r;
+    }
+  return QRectF();
+}
+
+// [tested] receives the segments checked against the states: those which were split and those of the route
+QPolygonF EdgeRouter::compute(const Transition *transition, QPointF from, QPointF to, QVector<QLineF>& tested) const
+{
+  QPolygonF points;
+  points << from << to;
+  for ( int n=0; n<maxDetours; n++ ) {
+    QPointF waypoint;
+    int i = 0;
+    while ( i+1 < points.count() && ! findDetour(transition, QLineF(points.at(i), points.at(i+1)), waypoint) ) i++;
+    if ( i+1 == points.count() ) break;  // No segment crosses a state
+    tested.append(QLineF(points.at(i), points.at(i+1)));
+    points.insert(i+1, waypoint);
+    }
+  for ( int i=0; i+1<points.count(); i++ )
+    tested.append(QLineF(points.at(i), points.at(i+1)));
+  points.removeFirst();
+  points.removeLast();
+  return points;
+}
+
+QPainterPath EdgeRouter::spline(const QPolygonF& points)
+{
+  QPainterPath path;
+  if ( points.isEmpty() ) return path;
+  path.moveTo(points.first());
+  int n = points.count();
+  for ( int i=0; i+1<n; i++ ) {
+    QPointF p0 = points.at(qMax(i-1, 0));
+    QPointF p1 = points.at(i);
+    QPointF p2 = points.at(i+1);
+    QPointF p3 = points.at(qMin(i+2, n-1));
+    path.cubicTo(p1 + (p2 - p0) / 6, p2 - (p3 - p1) / 6, p2);
+    }
+  return path;
+}
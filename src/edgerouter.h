@@ -0,0 +1,82 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef EDGEROUTER_H
+#define EDGEROUTER_H
+
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QVector>
+#include <QLineF>
+#include <QPolygonF>
+#include <QPainterPath>
+#include "spatialindex.h"
+
+class State;
+class Transition;
+
+// Routes transitions around the states lying between their end states.
+//
+// A route starts as the straight line between its end points. Each segment crossing a state
+// is then split at a point beside this state, on the side closer to the segment, until no
+// segment crosses any state (or a maximum number of detours is reached). The resulting
+// points are joined by a smooth curve (see [spline]).
+//
+// Routes are cached, together with their corridor, i.e. the area that a state has to enter
+// or leave for the route to change: around the segments tested while computing the route and
+// around the curve finally drawn. [invalidate] gives the routes to be recomputed when a state
+// moves, so that only these are. A corridor is indexed as a chain of small pieces, so that its
+// cost, and the number of moves invalidating it, grow with the length of the route and not
+// with the area of its bounding rect.
+
+class EdgeRouter
+{
+public:
+    // [obstacles] holds the scene bounding rects of the states (see Model::stateGrid)
+    explicit EdgeRouter(const SpatialIndex<State*>& obstacles);
+
+    // The intermediate points of the route from [from] to [to], excluding these two
+    QPolygonF route(Transition *transition, QPointF from, QPointF to);
+    void remove(Transition *transition);
+    void clear();
+
+    // Adds to [res] the transitions whose route may change when a state enters or leaves [rect]
+    void invalidate(const QRectF& rect, QSet<Transition*>& res);
+
+    // Catmull-Rom spline through [points]
+    static QPainterPath spline(const QPolygonF& points);
+
+    static qreal clearance;  // Between routes and the states they go round
+    static int maxDetours;
+
+private:
+    struct Route {
+      QPointF from, to;
+      QPolygonF waypoints;
+      int nbPieces;  // Of its corridor
+      bool valid;
+    };
+    typedef QPair<Transition*, int> Piece;
+
+    const SpatialIndex<State*>& obstacles;
+    QHash<Transition*, Route> routes;
+    SpatialIndex<Piece> corridors;
+
+    QPolygonF compute(const Transition *transition, QPointF from, QPointF to, QVector<QLineF>& tested) const;
+    bool findDetour(const Transition *transition, const QLineF& segment, QPointF& waypoint) const;
+    QRectF blocker(const Transition *transition, QPointF p) const;
+    void removeCorridor(Transition *transition, Route& route);
+    void insertCorridor(Transition *transition, Route& route, const QVector<QLineF>& tested);
+};
+
+#endif // EDGEROUTER_H
@@ -0,0 +1,153 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "exporter.h"
+#include "graph.h"
+#include "include/nlohmann_json.h"
+
+bool exportGraph(const GraphView& graph, ExportSink& sink)
+{
+  return exportGraph(graph, QList<ExportSink*>() << &sink);
+}
+
+bool exportGraph(const GraphView& graph, const QList<ExportSink*>& sinks)
+{
+  for ( ExportSink *sink: sinks ) sink->begin(graph);
+  int nbNodes = graph.nbNodes();
+  for ( int n=0; n<nbNodes; n++ )
+    for ( ExportSink *sink: sinks ) sink->node(graph, n);
+  int nbEdges = graph.nbEdges();
+  for ( int e=0; e<nbEdges; e++ )
+    for ( ExportSink *sink: sinks ) sink->edge(graph, e);
+  bool ok = true;
+  for ( ExportSink *sink: sinks )
+    if ( ! sink->end(graph) ) ok = false;
+  return ok;
+}
+
+bool exportGraph(const Graph& graph, ExportSink& sink)
+{
+  return exportGraph(Graph::View(graph), sink);
+}
+
+bool exportGraph(const Graph& graph, const QList<ExportSink*>& sinks)
+{
+  return exportGraph(Graph::View(graph), sinks);
+}
+
+// DOT
+
+void DotSink::begin(const GraphView&)
+{
+  os << "digraph main {\n";
+  os << "layout = dot\n";
+  os << "rankdir = UD\n";
+  os << "size = \"8.5,11\"\n";
+  os << "center = 1\n";
+  os << "nodesep = \"0.350000\"\n";
+  os << "ranksep = \"0.400000\"\n";
+  os << "fontsize = 14\n";
+  os << "mindist=1.0\n";
+}
+
+void DotSink::node(const GraphView& graph, int n)
+{
+  QString id = graph.nodeId(n);
+  if ( graph.isPseudo(n) )
+    os << id << " [shape=point]\n";
+  else
+    os << id << " [label=\"" << id << "\", shape=circle, style=solid]\n";
+}
+
+void DotSink::edge(const GraphView& graph, int e)
+{
+  os << graph.nodeId(graph.edgeSrc(e)) << " -> " << graph.nodeId(graph.edgeDst(e));
+  if ( graph.isInitial(e) )
+    os << "\n";
+  else
+    os << " [label=\"" << Graph::dotLabel(graph.edgeLabel(e), "") << "\"]\n";
+}
+
+bool DotSink::end(const GraphView&)
+{
+  os << "}\n";
+  os.flush();
+  return os.ok();
+}
+
+// JSON
+
+static std::string value(const nlohmann::json& v)
+{
+  return v.dump();
+}
+
+JsonSink::JsonSink(QIODevice *device, bool compact)
+  : os(device), compact(compact), nbNodes(0), nbEdges(0)
+{
+  nl1 = compact ? "" : "\n  ";      // Before a top-level key
+  nl2 = compact ? "" : "\n    ";    // Before an array element
+  nl3 = compact ? "" : "\n      ";  // Before a record field
+  sep = compact ? ":" : ": ";
+}
+
+void JsonSink::begin(const GraphView& graph)
+{
+  // Each id and label is escaped once, however many edges refer to it
+  quotedIds.resize(graph.nbNodes());
+  quotedLabels.clear();
+  os << "{" << nl1 << "\"states\"" << sep;
+  if ( graph.nbNodes() == 0 ) os << "[]";
+  else os << "[";
+}
+
+void JsonSink::node(const GraphView& graph, int n)
+{
+  quotedIds[n] = value(graph.nodeId(n).toStdString());
+  os << (nbNodes++ > 0 ? "," : "") << nl2 << "{";
+  os << nl3 << "\"id\"" << sep << quotedIds[n] << ",";
+  os << nl3 << "\"x\"" << sep << value(graph.nodeX(n)) << ",";
+  os << nl3 << "\"y\"" << sep << value(graph.nodeY(n));
+  os << nl2 << "}";
+}
+
+void JsonSink::edge(const GraphView& graph, int e)
+{
+  QString label = graph.edgeLabel(e);
+  auto quotedLabel = quotedLabels.find(label);
+  if ( quotedLabel == quotedLabels.end() )
+    quotedLabel = quotedLabels.insert(label, value(label.toStdString()));
+  if ( nbEdges == 0 ) {
+    // End of the states, start of the transitions
+    if ( nbNodes > 0 ) os << nl1 << "]";
+    os << "," << nl1 << "\"transitions\"" << sep << "[";
+    }
+  os << (nbEdges++ > 0 ? "," : "") << nl2 << "{";
+  os << nl3 << "\"dst_state\"" << sep << quotedIds[graph.edgeDst(e)] << ",";
+  os << nl3 << "\"label\"" << sep << *quotedLabel << ",";
+  os << nl3 << "\"location\"" << sep << value(graph.edgeLocation(e)) << ",";
+  os << nl3 << "\"src_state\"" << sep << quotedIds[graph.edgeSrc(e)];
+  os << nl2 << "}";
+}
+
+bool JsonSink::end(const GraphView&)
+{
+  if ( nbEdges == 0 ) {
+    if ( nbNodes > 0 ) os << nl1 << "]";
+    os << "," << nl1 << "\"transitions\"" << sep << "[]";
+    }
+  else
+    os << nl1 << "]";
+  os << (compact ? "" : "\n") << "}";
+  os.flush();
+  return os.ok();
+}
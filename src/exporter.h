@@ -0,0 +1,84 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <string>
+#include "bufferedwriter.h"
+
+class Graph;
+class GraphView;
+
+// Exporting a graph is a single traversal (all nodes, then all edges) feeding one or several
+// sinks, each one producing a given format. Text sinks write through a BufferedWriter.
+// Graphs are read through the GraphView interface, so that models can be exported as well.
+
+class ExportSink
+{
+public:
+    virtual ~ExportSink() { }
+
+    virtual void begin(const GraphView&) { }
+    virtual void node(const GraphView& graph, int n) = 0;
+    virtual void edge(const GraphView& graph, int e) = 0;
+    virtual bool end(const GraphView&) { return true; }  // Returns false on (write) errors
+};
+
+bool exportGraph(const GraphView& graph, ExportSink& sink);
+bool exportGraph(const GraphView& graph, const QList<ExportSink*>& sinks);  // All sinks in one pass
+bool exportGraph(const Graph& graph, ExportSink& sink);
+bool exportGraph(const Graph& graph, const QList<ExportSink*>& sinks);
+
+// DOT text, for the graphviz tools
+
+class DotSink : public ExportSink
+{
+public:
+    explicit DotSink(QIODevice *device) : os(device) { }
+
+    void begin(const GraphView& graph) override;
+    void node(const GraphView& graph, int n) override;
+    void edge(const GraphView& graph, int e) override;
+    bool end(const GraphView& graph) override;
+
+private:
+    BufferedWriter os;
+};
+
+// .fsd format. The output is identical to that of nlohmann::json::dump(2) (resp. dump())
+// applied to the equivalent DOM, with object keys in lexicographic order
+
+class JsonSink : public ExportSink
+{
+public:
+    JsonSink(QIODevice *device, bool compact);
+
+    void begin(const GraphView& graph) override;
+    void node(const GraphView& graph, int n) override;
+    void edge(const GraphView& graph, int e) override;
+    bool end(const GraphView& graph) override;
+
+private:
+    BufferedWriter os;
+    bool compact;
+    const char *nl1, *nl2, *nl3, *sep;
+    QVector<std::string> quotedIds;  // Escaped node ids, by node index
+    QHash<QString,std::string> quotedLabels;  // Each label is escaped once
+    int nbNodes, nbEdges;         // Written so far
+};
+
+#endif // EXPORTER_H
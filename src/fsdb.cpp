@@ -0,0 +1,182 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+// Reading and writing diagrams in the binary (.fsdb) format (see fsdb.h)
+
+#include "graph.h"
+#include "fsdb.h"
+#include "bufferedwriter.h"
+
+#include <QtEndian>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <cstring>
+#include <stdexcept>
+
+static quint32 readWord(const char *p)
+{
+  return qFromLittleEndian<quint32>(p);
+}
+
+static double readReal(const char *p)
+{
+  quint64 bits = qFromLittleEndian<quint64>(p);
+  double v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static void writeWord(BufferedWriter& os, quint32 v)
+{
+  char buf[4];
+  qToLittleEndian<quint32>(v, buf);
+  os.write(buf, 4);
+}
+
+static void writeReal(BufferedWriter& os, double v)
+{
+  quint64 bits;
+  std::memcpy(&bits, &v, sizeof(v));
+  char buf[8];
+  qToLittleEndian<quint64>(bits, buf);
+  os.write(buf, 8);
+}
+
+static void invalid(const char *msg)
+{
+  throw std::invalid_argument(std::string("Graph::fromBinary: ") + msg);
+}
+
+bool Graph::isBinary(const char *data, qint64 size)
+{
+  return size >= Fsdb::headerSize && std::memcmp(data, Fsdb::magic, 4) == 0;
+}
+
+void Graph::fromBinary(const char *data, qint64 size)
+{
+  if ( ! isBinary(data, size) ) invalid("not a FSDB file");
+  if ( readWord(data+4) != Fsdb::version ) invalid("unsupported version");
+  qint64 nbStrings = readWord(data+8);
+  qint64 nbStates = readWord(data+12);
+  qint64 nbTransitions = readWord(data+16);
+  qint64 stringBytes = readWord(data+20);
+
+  qint64 stringsOffset = Fsdb::headerSize + 4*(nbStrings+1);
+  qint64 statesOffset = stringsOffset + Fsdb::padded(stringBytes);
+  qint64 transitionsOffset = statesOffset + Fsdb::stateSize*nbStates;
+  if ( transitionsOffset + Fsdb::transitionSize*nbTransitions > size ) invalid("truncated file");
+  const char *offsets = data + Fsdb::headerSize;
+  const char *strData = data + stringsOffset;
+  const char *statesData = data + statesOffset;
+  const char *transitionsData = data + transitionsOffset;
+
+  clear();
+  reserve(nbStates, nbTransitions);
+
+  // Strings are decoded once, whatever the number of states and transitions refering to them
+  QVector<quint32> stringTable(nbStrings);
+  for ( qint64 i=0; i<nbStrings; i++ ) {
+    quint32 start = readWord(offsets + 4*i);
+    quint32 end = readWord(offsets + 4*(i+1));
+    if ( start > end || end > stringBytes ) invalid("invalid string table");
+    stringTable[i] = intern(QString::fromUtf8(strData + start, end - start));
+    }
+
+  for ( qint64 i=0; i<nbStates; i++ ) {
+    const char *p = statesData + Fsdb::stateSize*i;
+    quint32 id = readWord(p);
+    if ( id >= nbStrings ) invalid("invalid state id");
+    const QString& name = string(stringTable[id]);
+    // The pseudo-state flag is redundant with its reserved id, so both must agree
+    bool pseudo = readWord(p+4) & Fsdb::pseudoStateFlag;
+    if ( pseudo != (name == initPseudoId) ) invalid("pseudo-state flag inconsistent with state id");
+    addNode(name, readReal(p+8), readReal(p+16));
+    }
+
+  for ( qint64 i=0; i<nbTransitions; i++ ) {
+    const char *p = transitionsData + Fsdb::transitionSize*i;
+    quint32 src = readWord(p);
+    quint32 dst = readWord(p+4);
+    quint32 label = readWord(p+8);
+    quint32 location = readWord(p+12);
+    if ( src >= nbStates || dst >= nbStates ) invalid("invalid state index");
+    if ( label >= nbStrings ) invalid("invalid label");
+    if ( location > (quint32)West ) invalid("invalid location");
+    addEdge(src, dst, string(stringTable[label]), Location(location));
+    }
+}
+
+bool Graph::toBinary(QIODevice *device) const
+{
+  return toBinary(View(*this), device);
+}
+
+bool Graph::toBinary(const GraphView& graph, QIODevice *device)
+{
+  int nbNodes = graph.nbNodes();
+  int nbEdges = graph.nbEdges();
+  // Only the strings actually used are written, in order of first use
+  QHash<QString,quint32> stringNumbers;
+  QList<QByteArray> table;
+  auto number = [&](const QString& s) {
+    auto it = stringNumbers.find(s);
+    if ( it == stringNumbers.end() ) {
+      it = stringNumbers.insert(s, table.count());
+      table.append(s.toUtf8());
+      }
+    return it.value();
+  };
+  for ( int n=0; n<nbNodes; n++ ) number(graph.nodeId(n));
+  for ( int e=0; e<nbEdges; e++ ) number(graph.edgeLabel(e));
+  quint32 stringBytes = 0;
+  for ( const auto& s: table ) stringBytes += s.size();
+
+  BufferedWriter os(device);
+
+  os.write(Fsdb::magic, 4);
+  writeWord(os, Fsdb::version);
+  writeWord(os, table.count());
+  writeWord(os, nbNodes);
+  writeWord(os, nbEdges);
+  writeWord(os, stringBytes);
+  writeWord(os, 0);
+  writeWord(os, 0);
+
+  quint32 offset = 0;
+  writeWord(os, offset);
+  for ( const auto& s: table ) {
+    offset += s.size();
+    writeWord(os, offset);
+    }
+  for ( const auto& s: table )
+    os << s;
+  const char zeros[8] = { 0 };
+  os.write(zeros, Fsdb::padded(stringBytes) - stringBytes);
+
+  for ( int n=0; n<nbNodes; n++ ) {
+    writeWord(os, number(graph.nodeId(n)));
+    writeWord(os, graph.isPseudo(n) ? Fsdb::pseudoStateFlag : 0);
+    writeReal(os, graph.nodeX(n));
+    writeReal(os, graph.nodeY(n));
+    }
+
+  for ( int e=0; e<nbEdges; e++ ) {
+    writeWord(os, graph.edgeSrc(e));
+    writeWord(os, graph.edgeDst(e));
+    writeWord(os, number(graph.edgeLabel(e)));
+    writeWord(os, graph.edgeLocation(e));
+    }
+
+  os.flush();
+  return os.ok();
+}
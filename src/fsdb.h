@@ -0,0 +1,42 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+
+// Layout of the binary diagram format (.fsdb)
+//
+// All integers are unsigned 32-bit and all reals IEEE-754 doubles, stored in little-endian order.
+//
+//   header        magic ("FSDB"), version, nb of strings, nb of states, nb of transitions,
+//                 size of the string data (in bytes), 2 reserved words
+//   string table  (nb of strings + 1) offsets in the string data, followed by the string data
+//                 itself (UTF-8, no terminator), padded with zeros to a multiple of 8 bytes
+//   states        for each state: string index of its id, flags, x, y
+//   transitions   for each transition: index of the source state, index of the destination state,
+//                 string index of the label, location
+//
+// Each distinct id or label appears once in the string table.
+
+namespace Fsdb {
+  const char magic[4] = { 'F', 'S', 'D', 'B' };
+  const quint32 version = 1;
+
+  const int headerSize = 32;
+  const int stateSize = 24;
+  const int transitionSize = 16;
+
+  const quint32 pseudoStateFlag = 1;
+
+  inline qint64 padded(qint64 n) { return (n + 7) & ~qint64(7); }
+}
@@ -0,0 +1,337 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "graph.h"
+#include "include/nlohmann_json.h"
+#include "exporter.h"
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <stdexcept>
+
+const char * const Graph::initPseudoId = "_init";
+
+Graph::Graph()
+{
+  initNodeIndex = -1;
+}
+
+void Graph::clear()
+{
+  nodeTable.clear();
+  edgeTable.clear();
+  strings.clear();
+  stringIndex.clear();
+  nodeIndexById.clear();
+  initNodeIndex = -1;
+}
+
+void Graph::reserve(int nbNodes, int nbEdges)
+{
+  nodeTable.reserve(nbNodes);
+  edgeTable.reserve(nbEdges);
+  nodeIndexById.reserve(nbNodes);
+}
+
+quint32 Graph::intern(const QString& s)
+{
+  auto it = stringIndex.find(s);
+  if ( it != stringIndex.end() ) return it.value();
+  quint32 i = strings.count();
+  stringIndex.insert(s, i);
+  strings.append(s);
+  return i;
+}
+
+int Graph::addNode(const QString& id, double x, double y)
+{
+  Node node;
+  node.id = intern(id);
+  node.pseudo = id == initPseudoId;
+  node.x = x;
+  node.y = y;
+  int n = nodeTable.count();
+  nodeTable.append(node);
+  nodeIndexById.insert(node.id, n);
+  if ( node.pseudo ) initNodeIndex = n;
+  return n;
+}
+
+int Graph::addEdge(int src, int dst, const QString& label, Location location)
+{
+  Edge edge;
+  edge.src = src;
+  edge.dst = dst;
+  edge.label = intern(label);
+  edge.location = location;
+  edgeTable.append(edge);
+  return edgeTable.count() - 1;
+}
+
+int Graph::nodeIndex(const QString& id) const
+{
+  auto it = stringIndex.find(id);
+  return it != stringIndex.end() ? nodeIndexById.value(it.value(), -1) : -1;
+}
+
+// SAX event handler for .fsd files.
+// Nodes and edges are created as soon as their JSON object has been read, without
+// building a DOM. Transitions are only buffered when they refer to a state not read yet.
+
+class Graph::JsonLoader : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+  explicit JsonLoader(Graph *graph) : graph(graph) { }
+
+  bool null() override { return true; }
+  bool boolean(bool) override { return true; }
+  bool number_integer(number_integer_t val) override { return number((double)val); }
+  bool number_unsigned(number_unsigned_t val) override { return number((double)val); }
+  bool number_float(number_float_t val, const string_t&) override { return number(val); }
+
+  bool string(string_t& val) override
+  {
+    if ( ! inRecord() ) return true;
+    if ( field_key == "id" ) { record.id = std::move(val); record.fields |= Id; }
+    else if ( field_key == "src_state" ) { record.src = std::move(val); record.fields |= Src; }
+    else if ( field_key == "dst_state" ) { record.dst = std::move(val); record.fields |= Dst; }
+    else if ( field_key == "label" ) { record.label = std::move(val); record.fields |= Label; }
+    return true;
+  }
+
+  bool key(string_t& val) override
+  {
+    if ( depth == 1 ) section_key = val;
+    else if ( depth == 3 ) field_key = val;
+    return true;
+  }
+
+  bool start_object(std::size_t) override
+  {
+    depth++;
+    if ( depth == 3 && section != NoSection ) {
+      record = Record();
+      recording = true;
+      }
+    return true;
+  }
+
+  bool end_object() override
+  {
+    if ( inRecord() ) {
+      recording = false;
+      if ( section == States ) addState(); else addTransition();
+      }
+    depth--;
+    return true;
+  }
+
+  bool start_array(std::size_t) override
+  {
+    depth++;
+    if ( depth == 2 ) {
+      if ( section_key == "states" ) { section = States; hasStates = true; }
+      else if ( section_key == "transitions" ) { section = Transitions; hasTransitions = true; }
+      }
+    return true;
+  }
+
+  bool end_array() override
+  {
+    if ( depth == 2 ) section = NoSection;
+    depth--;
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+  {
+    throw std::invalid_argument(std::string("Graph::fromJson: ") + ex.what());
+  }
+
+  void finish()
+  {
+    if ( ! hasStates ) missing("states");
+    if ( ! hasTransitions ) missing("transitions");
+    for ( const Record& r : pending ) {
+      int src = graph->nodeIndex(QString::fromStdString(r.src));
+      int dst = graph->nodeIndex(QString::fromStdString(r.dst));
+      if ( src < 0 || dst < 0 )
+        throw std::invalid_argument("Graph::fromJson: invalid state id");
+      graph->addEdge(src, dst, QString::fromStdString(r.label), location(r.location));
+      }
+    pending.clear();
+  }
+
+private:
+  enum Section { NoSection, States, Transitions };
+  enum Field { Id=1, X=2, Y=4, Src=8, Dst=16, Label=32, Location=64 };
+
+  struct Record {
+    std::string id, src, dst, label;
+    double x = 0, y = 0;
+    int location = 0;
+    int fields = 0;
+  };
+
+  Graph *graph;
+  int depth = 0;
+  Section section = NoSection;
+  bool recording = false;
+  bool hasStates = false;
+  bool hasTransitions = false;
+  std::string section_key, field_key;
+  Record record;
+  QList<Record> pending;  // Transitions refering to states not read yet
+
+  bool inRecord() const { return recording && depth == 3; }
+
+  bool number(double val)
+  {
+    if ( ! inRecord() ) return true;
+    if ( field_key == "x" ) { record.x = val; record.fields |= X; }
+    else if ( field_key == "y" ) { record.y = val; record.fields |= Y; }
+    else if ( field_key == "location" ) { record.location = (int)val; record.fields |= Location; }
+    return true;
+  }
+
+  static void missing(const char *field)
+  {
+    throw std::invalid_argument(std::string("Graph::fromJson: missing field: ") + field);
+  }
+
+  static Graph::Location location(int loc)
+  {
+    switch ( loc ) {
+      case 1: return North;
+      case 2: return South;
+      case 3: return East;
+      case 4: return West;
+      default: return None;
+      }
+  }
+
+  void addState()
+  {
+    if ( ! (record.fields & Id) ) missing("id");
+    if ( ! (record.fields & X) ) missing("x");
+    if ( ! (record.fields & Y) ) missing("y");
+    graph->addNode(QString::fromStdString(record.id), record.x, record.y);
+  }
+
+  void addTransition()
+  {
+    if ( ! (record.fields & Src) ) missing("src_state");
+    if ( ! (record.fields & Dst) ) missing("dst_state");
+    if ( ! (record.fields & Label) ) missing("label");
+    if ( ! (record.fields & Location) ) missing("location");
+    int src = graph->nodeIndex(QString::fromStdString(record.src));
+    int dst = graph->nodeIndex(QString::fromStdString(record.dst));
+    if ( src < 0 || dst < 0 ) {
+      pending.append(record);
+      return;
+      }
+    graph->addEdge(src, dst, QString::fromStdString(record.label), location(record.location));
+  }
+};
+
+quint64 Graph::structuralHash() const
+{
+  QVector<quint64> stringHashes(strings.count());
+  for ( int i=0; i<strings.count(); i++ )
+    stringHashes[i] = qHash(strings[i]);
+  // FNV-1a, on 64-bit words
+  quint64 h = 14695981039346656037ULL;
+  auto mix = [&h](quint64 v) { h = (h ^ v) * 1099511628211ULL; };
+  mix(nodeTable.count());
+  for ( const Node& node: nodeTable ) {
+    mix(stringHashes[node.id]);
+    mix(node.pseudo);
+    }
+  mix(edgeTable.count());
+  for ( const Edge& edge: edgeTable ) {
+    mix(edge.src);
+    mix(edge.dst);
+    mix(stringHashes[edge.label]);
+    }
+  return h;
+}
+
+void Graph::fromJson(const char *data, qint64 size)
+{
+    clear();
+    JsonLoader loader(this);
+    nlohmann::json::sax_parse(data, data + size, &loader);
+    loader.finish();
+}
+
+void Graph::load(const QString& fname)
+{
+    QFile file(fname);
+    if ( ! file.open(QIODevice::ReadOnly) )
+      throw std::runtime_error(file.errorString().toStdString());
+    // The file contents are handed to the parser as raw bytes, mapped in memory when possible.
+    // The mapping is released when [file] is closed
+    qint64 size = file.size();
+    const char *data = size > 0 ? (const char *)file.map(0, size) : NULL;
+    QByteArray bytes;
+    if ( data == NULL ) {
+      bytes = file.readAll();
+      data = bytes.constData();
+      size = bytes.size();
+      }
+    load(data, size);
+}
+
+void Graph::load(const char *data, qint64 size)
+{
+    if ( isBinary(data, size) )
+      fromBinary(data, size);
+    else if ( isScxml(data, size) )
+      fromScxml(data, size);
+    else
+      fromJson(data, size);
+}
+
+bool Graph::toJson(QIODevice *device, bool compact) const
+{
+    JsonSink sink(device, compact);
+    return exportGraph(*this, sink);
+}
+
+bool Graph::splitLabel(const QString& label, QString& event, QString& action)
+{
+  int slash = label.indexOf('/');
+  if ( slash < 0 || label.indexOf('/', slash + 1) >= 0 ) {
+    event = label;
+    action.clear();
+    return false;
+    }
+  event = label.left(slash);
+  action = label.mid(slash + 1);
+  return true;
+}
+
+QString Graph::dotLabel(const QString& label, const QString& lrpad)
+{
+  QString event, action;
+  if ( ! splitLabel(label, event, action) ) return label;
+  int n = std::max(event.length(), action.length());
+  return lrpad + event + lrpad
+       + "\n" + lrpad + QString(n, '_') + lrpad  + "\n"
+       + lrpad + action + lrpad;
+}
+
+bool Graph::exportDot(QIODevice *device) const
+{
+  DotSink sink(device);
+  return exportGraph(*this, sink);
+}
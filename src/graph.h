@@ -0,0 +1,126 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QIODevice>
+#include "graphview.h"
+
+// A state diagram as plain data, independent of any graphics item.
+//
+// States (nodes) and transitions (edges) are stored in contiguous arrays and designated by
+// their index in these arrays. Ids and labels are interned: each distinct string is stored
+// once and nodes and edges only hold its index. Reading, writing, exporting and analysing
+// diagrams is done on this representation. The [Model] is the (editable) view of a graph.
+
+class Graph
+{
+public:
+    enum Location { None=0, North=1, South=2, East=3, West=4 }; // Same values as State::Location
+
+    struct Node {
+      quint32 id;     // String index
+      bool pseudo;    // Initial pseudo-state
+      double x, y;
+    };
+
+    struct Edge {
+      quint32 src, dst;  // Node indices
+      quint32 label;     // String index
+      Location location;
+    };
+
+    static const char * const initPseudoId;
+
+    Graph();
+    void clear();
+    void reserve(int nbNodes, int nbEdges);
+
+    quint32 intern(const QString& s);
+    const QString& string(quint32 i) const { return strings[i]; }
+    int nbStrings() const { return strings.count(); }
+
+    // [addNode] accepts duplicate ids, as the editor does; [nodeIndex] then returns the last one
+    int addNode(const QString& id, double x, double y);
+    int addEdge(int src, int dst, const QString& label, Location location);
+    int nodeIndex(const QString& id) const;  // -1 if none
+
+    const QVector<Node>& nodes() const { return nodeTable; }
+    const QVector<Edge>& edges() const { return edgeTable; }
+    const QString& nodeId(int n) const { return strings[nodeTable[n].id]; }
+    const QString& edgeLabel(int e) const { return strings[edgeTable[e].label]; }
+    int initNode() const { return initNodeIndex; }  // -1 if none
+    bool isInitial(int e) const { return nodeTable[edgeTable[e].src].pseudo; }
+
+    // Hash of everything that shapes the DOT output (ids, labels, connectivity), leaving out
+    // positions and loop locations
+    quint64 structuralHash() const;
+
+    void load(const QString& fname);  // .fsd, .fsdb or .scxml, detected from the contents
+    void load(const char *data, qint64 size);
+    void fromJson(const char *data, qint64 size);  // UTF-8 encoded .fsd contents
+    bool toJson(QIODevice *device, bool compact = false) const;
+    static bool isBinary(const char *data, qint64 size);
+    void fromBinary(const char *data, qint64 size);  // See fsdb.h
+    bool toBinary(QIODevice *device) const;
+    static bool toBinary(const GraphView& graph, QIODevice *device);
+    static bool isScxml(const char *data, qint64 size);
+    void fromScxml(const char *data, qint64 size);  // See scxml.h
+    bool toScxml(QIODevice *device) const;
+    bool exportDot(QIODevice *device) const;
+
+    // A label is made of an event and an action when it contains exactly one '/'. Otherwise it is
+    // taken as a whole, as an event
+    static bool splitLabel(const QString& label, QString& event, QString& action);
+    static QString dotLabel(const QString& label, const QString& lrpad);
+
+    class View;
+
+private:
+    class JsonLoader;
+
+    QVector<Node> nodeTable;
+    QVector<Edge> edgeTable;
+    QVector<QString> strings;
+    QHash<QString,quint32> stringIndex;
+    QHash<quint32,int> nodeIndexById;  // String index -> last node with this id
+    int initNodeIndex;
+};
+
+// A graph seen through the export interface
+
+class Graph::View : public GraphView
+{
+public:
+    explicit View(const Graph& graph) : graph(graph) { }
+
+    int nbNodes() const override { return graph.nodes().count(); }
+    int nbEdges() const override { return graph.edges().count(); }
+    QString nodeId(int n) const override { return graph.nodeId(n); }
+    bool isPseudo(int n) const override { return graph.nodes()[n].pseudo; }
+    double nodeX(int n) const override { return graph.nodes()[n].x; }
+    double nodeY(int n) const override { return graph.nodes()[n].y; }
+    int edgeSrc(int e) const override { return graph.edges()[e].src; }
+    int edgeDst(int e) const override { return graph.edges()[e].dst; }
+    QString edgeLabel(int e) const override { return graph.edgeLabel(e); }
+    int edgeLocation(int e) const override { return graph.edges()[e].location; }
+    int initNode() const override { return graph.initNode(); }
+
+private:
+    const Graph& graph;
+};
+
+#endif // GRAPH_H
@@ -0,0 +1,40 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#pragma once
+
+#include <QString>
+
+// Read-only access to a diagram, as needed to export it. States (nodes) and transitions (edges)
+// are designated by their index, from 0 to [nbNodes]-1 (resp. [nbEdges]-1). A [Graph] and a
+// [Model] can both be exported through this interface, the latter without being copied first.
+// Locations have the values of Graph::Location.
+
+class GraphView
+{
+public:
+    virtual ~GraphView() { }
+
+    virtual int nbNodes() const = 0;
+    virtual int nbEdges() const = 0;
+    virtual QString nodeId(int n) const = 0;
+    virtual bool isPseudo(int n) const = 0;
+    virtual double nodeX(int n) const = 0;
+    virtual double nodeY(int n) const = 0;
+    virtual int edgeSrc(int e) const = 0;
+    virtual int edgeDst(int e) const = 0;
+    virtual QString edgeLabel(int e) const = 0;
+    virtual int edgeLocation(int e) const = 0;
+    virtual int initNode() const = 0;  // -1 if none
+
+    bool isInitial(int e) const { return isPseudo(edgeSrc(e)); }
+};
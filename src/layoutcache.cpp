@@ -0,0 +1,148 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "layoutcache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDateTime>
+
+static const quint32 magic = 0x53534c43;  // "SSLC"
+static const quint32 version = 2;
+static const char *suffix = ".layout";
+static const int streamVersion = QDataStream::Qt_5_6;  // Cache files are shared by all builds
+
+static int cost(const DotLayout& layout)
+{
+  return qMax(1, layout.nodes.count() + layout.edges.count());
+}
+
+LayoutCache::LayoutCache(const QString& dir, int memoryCost, qint64 diskSize)
+  : dir(dir), memory(memoryCost), diskSize(diskSize), diskUsed(0), clock(0)
+{
+  QDir().mkpath(dir);
+  loadIndex();
+}
+
+QString LayoutCache::fileName(const QByteArray& key) const
+{
+  return QDir(dir).filePath(QString::fromLatin1(key.toHex()) + suffix);
+}
+
+bool LayoutCache::find(const QByteArray& key, DotLayout& layout)
+{
+  QMutexLocker lock(&mutex);
+  if ( DotLayout *l = memory.object(key) ) {
+    layout = *l;
+    if ( disk.contains(key) ) used(key);
+    return true;
+    }
+  if ( ! disk.contains(key) ) return false;
+  QFile file(fileName(key));
+  bool ok = false;
+  if ( file.open(QIODevice::ReadOnly) ) {
+    QDataStream is(&file);
+    is.setVersion(streamVersion);
+    quint32 m, v;
+    is >> m >> v;
+    if ( m == magic && v == version ) {
+      is >> layout;
+      ok = is.status() == QDataStream::Ok;
+      }
+    file.close();
+    }
+  if ( ! ok ) {
+    // Missing or unreadable : forget it
+    DiskEntry e = disk.take(key);
+    uses.remove(e.lastUse);
+    diskUsed -= e.size;
+    QFile::remove(fileName(key));
+    return false;
+    }
+  used(key);
+  memory.insert(key, new DotLayout(layout), cost(layout));
+  return true;
+}
+
+void LayoutCache::insert(const QByteArray& key, const DotLayout& layout)
+{
+  QMutexLocker lock(&mutex);
+  memory.insert(key, new DotLayout(layout), cost(layout));
+  QSaveFile file(fileName(key));
+  if ( ! file.open(QIODevice::WriteOnly) ) return;
+  QDataStream os(&file);
+  os.setVersion(streamVersion);
+  os << magic << version << layout;
+  if ( os.status() != QDataStream::Ok || ! file.commit() ) return;
+  touch(key, QFileInfo(fileName(key)).size());
+  evict();
+}
+
+// Records a new (just written) file, as the most recently used one
+void LayoutCache::touch(const QByteArray& key, qint64 size)
+{
+  auto it = disk.find(key);
+  if ( it != disk.end() ) {
+    diskUsed -= it->size;
+    uses.remove(it->lastUse);
+    }
+  DiskEntry& e = disk[key];
+  e.size = size;
+  e.lastUse = ++clock;
+  uses.insert(e.lastUse, key);
+  diskUsed += size;
+}
+
+// Records the use of an existing entry, in the modification time of its file first. Setting it
+// requires write access (on Windows). When it cannot be set, the entry keeps its rank, which
+// then remains the one the next session will see
+void LayoutCache::used(const QByteArray& key)
+{
+  QFile file(fileName(key));
+  if ( ! file.open(QIODevice::ReadWrite) ) return;
+  if ( ! file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime) ) return;
+  DiskEntry& e = disk[key];
+  uses.remove(e.lastUse);
+  e.lastUse = ++clock;
+  uses.insert(e.lastUse, key);
+}
+
+void LayoutCache::evict()
+{
+  while ( diskUsed > diskSize && disk.count() > 1 ) {
+    QByteArray oldest = uses.take(uses.firstKey());
+    QFile::remove(fileName(oldest));
+    memory.remove(oldest);
+    diskUsed -= disk.take(oldest).size;
+    }
+}
+
+// The order of use of the files across sessions (and instances) is given by their modification
+// time
+
+void LayoutCache::loadIndex()
+{
+  QFileInfoList files = QDir(dir).entryInfoList(QStringList() << QString("*") + suffix, QDir::Files, QDir::Time | QDir::Reversed);
+  for ( const auto& info: files ) {
+    QByteArray key = QByteArray::fromHex(info.completeBaseName().toLatin1());
+    DiskEntry& e = disk[key];
+    e.size = info.size();
+    e.lastUse = ++clock;
+    uses.insert(e.lastUse, key);
+    diskUsed += e.size;
+    }
+  evict();
+}
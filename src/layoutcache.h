@@ -0,0 +1,59 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef LAYOUTCACHE_H
+#define LAYOUTCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include "dotlayout.h"
+
+// Computed layouts, indexed by DotLayout::key.
+// Recently used layouts are kept in memory. All of them are also stored on disk, one file per
+// layout, so that they survive the session. Both levels are bounded, the least recently used
+// layouts being evicted first. The order of use is recorded in the modification time of the
+// files, so that it survives the session too. All methods can be called from any thread.
+
+class LayoutCache
+{
+public:
+    explicit LayoutCache(const QString& dir, int memoryCost = 1 << 18, qint64 diskSize = 64 << 20);
+
+    bool find(const QByteArray& key, DotLayout& layout);
+    void insert(const QByteArray& key, const DotLayout& layout);
+
+private:
+    struct DiskEntry {
+      qint64 size;
+      qint64 lastUse;
+    };
+
+    QString fileName(const QByteArray& key) const;
+    void touch(const QByteArray& key, qint64 size);
+    void used(const QByteArray& key);
+    void evict();
+    void loadIndex();
+
+    QMutex mutex;
+    QString dir;
+    QCache<QByteArray, DotLayout> memory;  // Cost : number of nodes and edges
+    QHash<QByteArray, DiskEntry> disk;
+    QMap<qint64, QByteArray> uses;  // Disk entries, by time of last use
+    qint64 diskSize;   // Bound
+    qint64 diskUsed;
+    qint64 clock;      // Logical time of the last use
+};
+
+#endif // LAYOUTCACHE_H
@@ -0,0 +1,23 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#pragma once
+
+#include <QtGlobal>
+
+// Level of detail tiers for painting diagram items, compared with the value of
+// QStyleOptionGraphicsItem::levelOfDetailFromTransform (1 at 100% zoom)
+
+namespace Lod {
+  const qreal text = 0.4;     // Below : no text (ids, labels) nor arrow heads
+  const qreal outline = 0.15; // Below : states drawn as filled rects, no antialiasing
+}
@@ -10,15 +10,22 @@
 /*                                                                     */
 /***********************************************************************/
 #include "mainwindow.h"
+#include "cli.h"
 
 #include <QApplication>
 
 int main(int argv, char *args[])
 {
+    if ( isCommandLineMode(argv, args) )
+        return runCommandLine(argv, args);
+
     QApplication app(argv, args);
+    app.setApplicationName("ssde"); // Names the cache and settings locations
     MainWindow mainWindow;
     mainWindow.setGeometry(100, 100, 1000, 600);
     mainWindow.show();
+    if ( argv > 1 )
+        mainWindow.loadFile(QString::fromLocal8Bit(args[1]));
 
     return app.exec();
 }
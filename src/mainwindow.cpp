@@ -14,11 +14,11 @@
 #include "state.h"
 #include "model.h"
 #include "mainwindow.h"
+#include "dotrenderer.h"
 #include "qt_compat.h"
 
 #include <QtWidgets>
 #include <QFile>
-#include <QTextStream>
 
 QString MainWindow::title = "SSDE";
 
@@ -28,6 +28,7 @@ double MainWindow::zoomInFactor = 1.25;
 double MainWindow::zoomOutFactor = 0.8;
 double MainWindow::minScaleFactor = 0.5;
 double MainWindow::maxScaleFactor = 2.0;
+int MainWindow::autoRenderDelay = 300; // ms
 
 MainWindow::MainWindow()
 {
@@ -53,6 +54,8 @@ MainWindow::MainWindow()
     editView = new QGraphicsView(model);
     editView->setMinimumWidth(200);
     editView->setMinimumHeight(400);
+    // Items have exact bounding rects, so only what actually changes needs repainting
+    editView->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
     layout->addWidget(editView);
 
     dotView = new QGraphicsView();
@@ -61,6 +64,22 @@ MainWindow::MainWindow()
     dotView->setMinimumHeight(400);
     layout->addWidget(dotView);
 
+    dotRenderer = new DotRenderer(dotView, this);
+    connect(dotRenderer, SIGNAL(started()), this, SLOT(renderStarted()));
+    connect(dotRenderer, SIGNAL(finished()), this, SLOT(renderFinished()));
+    connect(dotRenderer, SIGNAL(failed(const QString&)), this, SLOT(renderFailed(const QString&)));
+
+    renderProgress = new QProgressBar;
+    renderProgress->setRange(0, 0); // Busy indicator
+    renderProgress->setMaximumWidth(150);
+    renderProgress->setVisible(false);
+    statusBar()->addPermanentWidget(renderProgress);
+
+    renderTimer = new QTimer(this);
+    renderTimer->setSingleShot(true);
+    renderTimer->setInterval(autoRenderDelay);
+    connect(renderTimer, SIGNAL(timeout()), this, SLOT(autoRender()));
+
     QWidget *widget = new QWidget;
     widget->setLayout(layout);
 
@@ -102,6 +121,8 @@ void MainWindow::transitionSelected(Transition *transition)
 void MainWindow::modelModified()
 {
   setUnsavedChanges(true);
+  // A burst of modifications only triggers one rendering, once it is over
+  if ( autoRenderAction->isChecked() ) renderTimer->start();
 }
 
 void MainWindow::updateCursor()
@@ -141,6 +162,13 @@ void MainWindow::createActions()
     saveFileAsAction->setShortcut(QKeySequence::SaveAs);
     connect(saveFileAsAction, SIGNAL(triggered()), this, SLOT(saveAs()));
  
+    compactSaveAction = new QAction(tr("Compact format"), this);
+    compactSaveAction->setCheckable(true);
+    compactSaveAction->setToolTip(tr("Save diagrams without indentation"));
+
+    exportScxmlAction = new QAction(tr("Export to SC&XML"), this);
+    connect(exportScxmlAction, SIGNAL(triggered()), this, SLOT(exportScxml()));
+
     aboutAction = new QAction(tr("A&bout"), this);
     aboutAction->setShortcut(tr("F1"));
     connect(aboutAction, SIGNAL(triggered()), this, SLOT(about()));
@@ -153,6 +181,11 @@ void MainWindow::createActions()
     renderDotAction->setShortcut(tr("Ctrl+R"));
     connect(renderDotAction, SIGNAL(triggered()), this, SLOT(renderDot()));
 
+    autoRenderAction = new QAction(tr("Auto render"), this);
+    autoRenderAction->setCheckable(true);
+    autoRenderAction->setToolTip(tr("Render the diagram again after each modification"));
+    connect(autoRenderAction, SIGNAL(triggered()), this, SLOT(autoRender()));
+
     zoomInAction = new QAction(tr("Zoom In"), this);
     zoomInAction->setShortcut(tr("Ctrl++"));
     connect(zoomInAction, SIGNAL(triggered()), this, SLOT(zoomIn()));
@@ -173,11 +206,14 @@ void MainWindow::createMenus()
     fileMenu->addAction(openFileAction);
     fileMenu->addAction(saveFileAction);
     fileMenu->addAction(saveFileAsAction);
+    fileMenu->addAction(compactSaveAction);
+    fileMenu->addAction(exportScxmlAction);
     fileMenu->addAction(aboutAction);
     fileMenu->addAction(exitAction);
 
     dotMenu = menuBar()->addMenu(tr("&Dot"));
     dotMenu->addAction(renderDotAction);
+    dotMenu->addAction(autoRenderAction);
     dotMenu->addAction(zoomInAction);
     dotMenu->addAction(zoomOutAction);
     dotMenu->addAction(exportDotAction);
@@ -260,22 +296,30 @@ void MainWindow::openFile()
 {
   checkUnsavedChanges();
     
-  QString fname = QFileDialog::getOpenFileName(this, "Open file", "", "FSD file (*.fsd)");
+  QString fname = QFileDialog::getOpenFileName(this, "Open file", "", "FSD file (*.fsd *.fsdb);;SCXML file (*.scxml)");
   if ( fname.isEmpty() ) return;
-  QFile file(fname);
-  qDebug() << "Opening file " << file.fileName();
-  file.open(QIODevice::ReadOnly);
-  if ( file.error() != QFile::NoError ) {
-    QMessageBox::warning(this, "","Cannot open file " + file.fileName());
+  loadFile(fname);
+}
+
+void MainWindow::loadFile(const QString& fname)
+{
+  qDebug() << "Opening file " << fname;
+  try {
+    model->load(fname);
+  }
+  catch ( const std::exception& e ) {
+    QMessageBox::warning(this, "","Cannot load file " + fname + "\n" + e.what());
+    model->clear();
+    properties_panel->clear();
+    currentFileName.clear();
+    setUnsavedChanges(false);
     return;
   }
-  QTextStream is(&file);
-  QString txt = is.readAll();
-  model->fromString(txt);
   editView->ensureVisible(model->itemsBoundingRect());
   properties_panel->clear();
   currentFileName = fname;
   setUnsavedChanges(false);
+  if ( autoRenderAction->isChecked() ) renderTimer->start();
 }
 
 void MainWindow::newDiagram()
@@ -285,18 +329,27 @@ void MainWindow::newDiagram()
   properties_panel->clear();
   currentFileName.clear();
   setUnsavedChanges(false);
+  if ( autoRenderAction->isChecked() ) renderTimer->start();
 }
 
 void MainWindow::saveToFile(QString fileName)
 {
   QFile file(fileName); 
-  file.open(QIODevice::WriteOnly | QIODevice::Text);
+  bool binary = fileName.endsWith(".fsdb", Qt::CaseInsensitive);
+  // In .fsd files, transitions designate states by id
+  if ( ! binary && model->hasDuplicateIds() )
+    QMessageBox::warning(this, "", "Several states have the same name.\n"
+                         "When reading the file back, their transitions will be attached to the last of them.");
+  file.open(binary ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text);
   if ( file.error() != QFile::NoError ) {
     QMessageBox::warning(this, "","Cannot open file " + file.fileName());
     return;
   }
-  QTextStream os(&file);
-  os << model->toString();
+  bool ok = binary ? model->toBinary(&file) : model->toJson(&file, compactSaveAction->isChecked());
+  if ( ! ok ) {
+    QMessageBox::warning(this, "","Cannot write file " + file.fileName());
+    return;
+  }
   setUnsavedChanges(false);
 }
 
@@ -308,7 +361,7 @@ void MainWindow::save()
 
 void MainWindow::saveAs()
 {
-  QString fname = QFileDialog::getSaveFileName( this, "Save to file", "", "FSD file (*.fsd)");
+  QString fname = QFileDialog::getSaveFileName( this, "Save to file", "", "FSD file (*.fsd);;Binary FSD file (*.fsdb)");
   if ( fname.isEmpty() ) return;
   saveToFile(fname);
 }
@@ -317,12 +370,51 @@ void MainWindow::exportDot()
 {
   QString fname = QFileDialog::getSaveFileName( this, "Export to DOT file", "", "DOT file (*.dot)");
   if ( fname.isEmpty() ) return;
-  model->exportDot(fname);
+  QFile file(fname);
+  file.open(QIODevice::WriteOnly | QIODevice::Text);
+  if ( file.error() != QFile::NoError || ! model->exportDot(&file) )
+    QMessageBox::warning(this, "","Cannot write file " + file.fileName());
+}
+
+void MainWindow::exportScxml()
+{
+  QString fname = QFileDialog::getSaveFileName( this, "Export to SCXML file", "", "SCXML file (*.scxml)");
+  if ( fname.isEmpty() ) return;
+  QFile file(fname);
+  file.open(QIODevice::WriteOnly | QIODevice::Text);
+  if ( file.error() != QFile::NoError || ! model->exportScxml(&file) )
+    QMessageBox::warning(this, "","Cannot write file " + file.fileName());
 }
 
 void MainWindow::renderDot()
 {
-  model->renderDot(dotView, scene_width, scene_height);
+  // The layout runs on a snapshot, so that the diagram can still be edited meanwhile
+  dotRenderer->render(model->toGraph());
+}
+
+void MainWindow::autoRender()
+{
+  renderTimer->stop();
+  if ( ! autoRenderAction->isChecked() ) return;
+  // Moving states does not change the structure, and thus does not trigger a new layout
+  dotRenderer->render(model->toGraph());
+}
+
+void MainWindow::renderStarted()
+{
+  renderProgress->setVisible(true);
+  statusBar()->showMessage("Rendering...");
+}
+
+void MainWindow::renderFinished()
+{
+  renderProgress->setVisible(false);
+  statusBar()->clearMessage();
+}
+
+void MainWindow::renderFailed(const QString& msg)
+{
+  QMessageBox::warning(this, "", "Cannot render diagram\n" + msg);
 }
 
 void MainWindow::zoomIn()
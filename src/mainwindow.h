@@ -21,10 +21,9 @@
 #include <QFrame>
 #include <QMap>
 #include <QCursor>
-#include "QGVScene.h"
-#include "QGVNode.h"
 
 class Model;
+class DotRenderer;
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -39,6 +38,8 @@ class QFont;
 class QToolButton;
 class QAbstractButton;
 class QGraphicsView;
+class QProgressBar;
+class QTimer;
 class SceneViewer;
 QT_END_NAMESPACE
 
@@ -52,9 +53,11 @@ class MainWindow : public QMainWindow
   static double zoomOutFactor;
   static double minScaleFactor;
   static double maxScaleFactor;
+  static int autoRenderDelay;
 
 public:
    MainWindow();
+   void loadFile(const QString& fname);
 
 private slots:
     void toolButtonClicked(int id);
@@ -70,7 +73,12 @@ private slots:
     void quit();
     void about();
     void exportDot();
+    void exportScxml();
     void renderDot();
+    void autoRender();
+    void renderStarted();
+    void renderFinished();
+    void renderFailed(const QString& msg);
     void zoomIn();
     void zoomOut();
     void updateCursor();
@@ -92,16 +100,22 @@ private:
 
     QGraphicsView *editView;
     QGraphicsView *dotView;
+    DotRenderer *dotRenderer;
+    QProgressBar *renderProgress;
+    QTimer *renderTimer;    // Debounces auto-rendering
     PropertiesPanel* properties_panel;
 
     QAction *newDiagramAction;
     QAction *openFileAction;
     QAction *saveFileAction;
     QAction *saveFileAsAction;
+    QAction *compactSaveAction;
     QAction *aboutAction;
     QAction *exitAction;
     QAction *exportDotAction;
+    QAction *exportScxmlAction;
     QAction *renderDotAction;
+    QAction *autoRenderAction;
     QAction *zoomInAction;
     QAction *zoomOutAction;
 
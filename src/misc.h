@@ -14,6 +14,7 @@
 
 #include <QList>
 #include <QSet>
+#include <QHash>
 #include "qt_compat.h"
 
 template <typename T>
@@ -22,9 +23,42 @@ QSet<T> QListToQSet(const QList<T>& qlist)
   return QSET_FROM_LIST(T,qlist);
 }
 
+// A list of items supporting O(1) insertion, removal and membership test.
+// Removal moves the last item into the freed slot, so the insertion order is only
+// preserved as long as no item is removed.
+
 template <typename T>
-QList<T> remove_duplicates(const QList<T>& l)
+class Registry
 {
-  return QListToQSet(l).values();
-}
+public:
+  void insert(T item)
+  {
+    if ( index.contains(item) ) return;
+    index.insert(item, list.count());
+    list.append(item);
+  }
+
+  bool remove(T item)
+  {
+    auto it = index.find(item);
+    if ( it == index.end() ) return false;
+    int i = it.value();
+    index.erase(it);
+    T last = list.takeLast();
+    if ( last != item ) {
+      list[i] = last;
+      index[last] = i;
+      }
+    return true;
+  }
+
+  bool contains(T item) const { return index.contains(item); }
+  int indexOf(T item) const { return index.value(item, -1); }
+  int count() const { return list.count(); }
+  const QList<T>& items() const { return list; }
+  void clear() { list.clear(); index.clear(); }
 
+private:
+  QList<T> list;
+  QHash<T,int> index;
+};
@@ -12,15 +12,16 @@
 
 #include "model.h"
 #include "transition.h"
-#include "include/nlohmann_json.h"
+#include "exporter.h"
+#include "scxml.h"
 #include <QMessageBox>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsScene>
 #include <QGraphicsView>
-#include "QGVScene.h"
-#include "QGVNode.h"
-#include "QGVEdge.h"
+#include <QTimer>
+#include <QBuffer>
 #include <QDebug>
+#include <functional>
 #include "qt_compat.h"
 
 int Model::stateCounter = 0;
@@ -28,11 +29,16 @@ QColor Model::lineColor = Qt::lightGray;
 QColor Model::boxColor = Qt::black;
 
 Model::Model(QWidget *parent)
-    : QGraphicsScene(parent)
+    : QGraphicsScene(parent), router(stateGrid)
 {
     mode = SelectItem;
     mainWindow = parent;
-    scene = NULL;
+    line = NULL;
+    startState = NULL;
+    pseudoState = NULL;
+    hoveredState = NULL;
+    updatePending = false;
+    statesMoved = false;
 }
 
 void Model::setMode(Mode mode)
@@ -51,6 +57,10 @@ State* Model::addState(QPointF pos, QString id)
   state->setBrush(boxColor);
   addItem(state);
   state->setPos(pos);
+  stateRegistry.insert(state);
+  stateGrid.insert(state, state->sceneBoundingRect());
+  reroute(state->sceneBoundingRect());
+  indexState(state);
   return state;
 }
 
@@ -60,39 +70,40 @@ State* Model::addPseudoState(QPointF pos)
    state->setBrush(boxColor);
    addItem(state);
    state->setPos(pos);
+   stateRegistry.insert(state);
+   stateGrid.insert(state, state->sceneBoundingRect());
+   reroute(state->sceneBoundingRect());
+   indexState(state);
+   pseudoState = state;
    return state;
 }
 
-QList<State*> Model::states()
+void Model::indexState(State* state)
 {
-  QList<State*> states;
-  for ( const auto item: items() )
-    if ( item->type() == State::Type )
-      states.append(qgraphicsitem_cast<State *>(item));
-  return states;
+  QString id = state->getId();
+  stateIndex.insert(id, state);
+  if ( stateIndex.count(id) > 1 ) duplicateIds.insert(id);
 }
 
-QList<Transition*> Model::transitions()
+void Model::unindexState(State* state)
 {
-  QList<Transition*> transitions;
-  for ( const auto item: items() )
-    if ( item->type() == Transition::Type )
-      transitions.append(qgraphicsitem_cast<Transition *>(item));
-  return transitions;
+  QString id = state->getId();
+  stateIndex.remove(id, state);
+  if ( stateIndex.count(id) < 2 ) duplicateIds.remove(id);
 }
 
-State* Model::getState(QString id)
+void Model::renameState(State* state, const QString& id)
 {
-  foreach ( State* s, states() )
-    if ( s->getId() == id ) return s;
-  return NULL;
+  if ( state->getId() == id ) return;
+  unindexState(state);
+  state->setId(id);
+  indexState(state);
+  emit modelModified();
 }
 
 bool Model::hasPseudoState()
 {
-  foreach ( State* s, states() )
-    if ( s->isPseudo() ) return true;
-  return false;
+  return pseudoState != NULL;
 }
 
 Transition* Model::addTransition(State* srcState, State* dstState, QString label, State::Location location)
@@ -102,9 +113,180 @@ Transition* Model::addTransition(State* srcState, State* dstState, QString label
   if ( dstState != srcState ) dstState->addTransition(transition); // Do not add self-transitions twice !
   transition->setZValue(-1000.0);
   addItem(transition);
+  transitionRegistry.insert(transition);
+  dirtyTransitions.insert(transition);
+  addToBundle(transition);
+  scheduleUpdate();
   return transition;
 }
 
+static QPair<State*,State*> bundleKey(Transition* transition)
+{
+  State *s1 = transition->srcState();
+  State *s2 = transition->dstState();
+  return std::less<State*>()(s1, s2) ? qMakePair(s1, s2) : qMakePair(s2, s1);
+}
+
+void Model::rankBundle(const QList<Transition*>& bundle)
+{
+  for ( int i=0; i<bundle.count(); i++ )
+    if ( bundle.at(i)->setBundleRank(i, bundle.count()) ) dirtyTransitions.insert(bundle.at(i));
+}
+
+// Bundles are ranked by the next call to [updateTransitions], once whatever the number
+// of transitions added to or removed from them in between
+
+void Model::addToBundle(Transition* transition)
+{
+  if ( transition->srcState() == transition->dstState() ) return;
+  QPair<State*,State*> key = bundleKey(transition);
+  QList<Transition*>& bundle = bundles[key];
+  if ( bundle.contains(transition) ) return;
+  bundle.append(transition);
+  dirtyBundles.insert(key);
+  scheduleUpdate();
+}
+
+void Model::removeFromBundle(Transition* transition)
+{
+  if ( transition->srcState() == transition->dstState() ) return;
+  QPair<State*,State*> key = bundleKey(transition);
+  auto it = bundles.find(key);
+  if ( it == bundles.end() ) return;
+  // The others keep their order, so that they do not swap places on screen
+  if ( ! it->removeOne(transition) ) return;
+  if ( it->isEmpty() ) {
+    bundles.erase(it);
+    dirtyBundles.remove(key);
+    }
+  else {
+    dirtyBundles.insert(key);
+    scheduleUpdate();
+    }
+}
+
+void Model::retargetTransition(Transition* transition, State* srcState, State* dstState)
+{
+  if ( srcState == transition->srcState() && dstState == transition->dstState() ) return;
+  // The end states index their transitions by peer, so detach before changing them
+  removeFromBundle(transition);
+  transition->srcState()->removeTransition(transition);
+  transition->dstState()->removeTransition(transition);
+  transition->setSrcState(srcState);
+  transition->setDstState(dstState);
+  srcState->addTransition(transition);
+  if ( dstState != srcState ) dstState->addTransition(transition);
+  dirtyTransitions.insert(transition);
+  addToBundle(transition);
+  scheduleUpdate();
+  emit modelModified();
+}
+
+void Model::setTransitionLabel(Transition* transition, const QString& label)
+{
+  if ( transition->getLabel() == label ) return;
+  transition->setLabel(label);
+  emit modelModified();
+}
+
+// The topmost state whose shape contains [pos]. As in the scene, a state is above the ones with
+// a lower z-value and, for equal z-values, above the ones inserted before it
+State* Model::stateAt(QPointF pos) const
+{
+  State *res = NULL;
+  foreach ( State *state, stateGrid.itemsAt(pos) )
+    if ( (res == NULL || state->zValue() >= res->zValue()) && state->shape().contains(state->mapFromScene(pos)) )
+      res = state;
+  return res;
+}
+
+void Model::stateMoved(State* state)
+{
+  if ( stateRegistry.contains(state) ) {
+    // Routes going by the old or the new position may have to change
+    QRectF rect = state->sceneBoundingRect();
+    router.invalidate(stateGrid.rect(state), dirtyTransitions);
+    router.invalidate(rect, dirtyTransitions);
+    stateGrid.insert(state, rect);
+    }
+  statesMoved = true;
+  state->collectTransitions(dirtyTransitions);
+  scheduleUpdate();
+}
+
+// A state has entered or left [rect]
+void Model::reroute(const QRectF& rect)
+{
+  router.invalidate(rect, dirtyTransitions);
+  scheduleUpdate();
+}
+
+void Model::scheduleUpdate()
+{
+  if ( ! updatePending && ( ! dirtyTransitions.isEmpty() || ! dirtyBundles.isEmpty() ) ) {
+    updatePending = true;
+    QTimer::singleShot(0, this, SLOT(updateTransitions()));
+    }
+}
+
+void Model::updateTransitions()
+{
+  foreach ( const auto& key, dirtyBundles ) {
+    auto it = bundles.constFind(key);
+    if ( it != bundles.constEnd() ) rankBundle(*it);
+    }
+  dirtyBundles.clear();
+  foreach ( Transition *transition, dirtyTransitions )
+    transition->updatePosition();
+  dirtyTransitions.clear();
+  updatePending = false;
+}
+
+void Model::removeTransition(Transition* transition)
+{
+  dirtyTransitions.remove(transition);
+  router.remove(transition);
+  transition->srcState()->removeTransition(transition);
+  transition->dstState()->removeTransition(transition);
+  removeFromBundle(transition);
+  transitionRegistry.remove(transition);
+  removeItem(transition);
+  delete transition;
+}
+
+void Model::removeState(State* state)
+{
+  foreach ( Transition *transition, state->getTransitions() )
+    removeTransition(transition);
+  stateRegistry.remove(state);
+  QRectF rect = stateGrid.rect(state);
+  stateGrid.remove(state);
+  reroute(rect);
+  unindexState(state);
+  if ( state == pseudoState ) pseudoState = NULL;
+  if ( state == hoveredState ) hoveredState = NULL;
+  removeItem(state);
+  delete state;
+}
+
+void Model::clear()
+{
+  stateRegistry.clear();
+  transitionRegistry.clear();
+  stateIndex.clear();
+  duplicateIds.clear();
+  bundles.clear();
+  dirtyBundles.clear();
+  dirtyTransitions.clear();
+  stateGrid.clear();
+  router.clear();
+  pseudoState = NULL;
+  hoveredState = NULL;
+  startState = NULL;
+  line = NULL;
+  QGraphicsScene::clear();
+}
+
 bool Model::event(QEvent *event)
 {
   //qDebug() << "Got event " << event->type();
@@ -126,14 +308,28 @@ bool Model::event(QEvent *event)
   return QGraphicsScene::event(event);
 }
 
+Transition* Model::transitionAt(QPointF pos)
+{
+  QGraphicsItem *item = itemAt(pos, QTransform());
+  return item != NULL && item->type() == Transition::Type ? qgraphicsitem_cast<Transition *>(item) : NULL;
+}
+
+void Model::setHoveredState(State* state)
+{
+  if ( state == hoveredState ) return;
+  if ( hoveredState != NULL ) hoveredState->setHighlighted(false);
+  hoveredState = state;
+  if ( hoveredState != NULL ) hoveredState->setHighlighted(true);
+}
+
 void Model::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
 {
     if (mouseEvent->button() != Qt::LeftButton) return;
     State *state;
     Transition *transition;
-    QGraphicsItem *item;
     switch ( mode ) {
         case InsertState:
+            if ( stateAt(mouseEvent->scenePos()) != NULL ) break; // Do not stack states
             state = addState(mouseEvent->scenePos(), QString::number(stateCounter++));
             //emit stateInserted(state);
             emit modelModified();
@@ -151,71 +347,43 @@ void Model::mousePressEvent(QGraphicsSceneMouseEvent *mouseEvent)
                                  "There's alreay one initial transition !\nDelete it first to add another one");
           break;
         case InsertTransition:
+            startState = stateAt(mouseEvent->scenePos());
             line = new QGraphicsLineItem(QLineF(mouseEvent->scenePos(), mouseEvent->scenePos()));
             line->setPen(QPen(lineColor, 2));
             addItem(line);
             emit modelModified();
             break;
         case InsertLoopTransition:
-          item = itemAt(mouseEvent->scenePos(), QTransform());
-          if ( item != NULL && item->type() == State::Type ) {
-            state = qgraphicsitem_cast<State *>(item);
-            if ( ! state->isPseudo() ) {
-              State::Location location = state->locateEvent(mouseEvent);
-              Transition *transition = addTransition(state, state, "", location);
-              transition->updatePosition();
-              emit modelModified();
-              //emit transitionInserted(transition);
-              }
+          state = stateAt(mouseEvent->scenePos());
+          if ( state != NULL && ! state->isPseudo() ) {
+            State::Location location = state->locateEvent(mouseEvent);
+            addTransition(state, state, "", location);
+            emit modelModified();
+            //emit transitionInserted(transition);
             }
             break;
         case DeleteItem:
-          item = itemAt(mouseEvent->scenePos(), QTransform());
-          if ( item != NULL ) {
-            switch ( item->type() ) {
-            case Transition::Type: {
-              transition = qgraphicsitem_cast<Transition *>(item);
-              State *srcState = transition->srcState();
-              State *dstState = transition->dstState();
-              if ( srcState->isPseudo() ) {
-                srcState->removeTransitions();
-                removeItem(srcState);
-                }
-              else {
-                srcState->removeTransition(transition);
-                dstState->removeTransition(transition);
-                removeItem(item);
-                delete item;
-                }
-              emit modelModified();
-              }
-              break;
-            case State::Type:
-              state = qgraphicsitem_cast<State *>(item);
-              state->removeTransitions();
-              removeItem(item);
-              emit modelModified();
-              delete item;
-              break;
-            default:
-              break;
+          state = stateAt(mouseEvent->scenePos());
+          if ( state != NULL ) {
+            removeState(state);
+            emit modelModified();
+            }
+          else if ( (transition = transitionAt(mouseEvent->scenePos())) != NULL ) {
+            State *srcState = transition->srcState();
+            if ( srcState->isPseudo() )
+              removeState(srcState);  // Also removes the initial transition
+            else
+              removeTransition(transition);
+            emit modelModified();
             }
-          }
           break;
         case SelectItem:
-          item = itemAt(mouseEvent->scenePos(), QTransform());
-          if ( item != NULL ) {
-            switch ( item->type() ) {
-              case State::Type:
-                emit(stateSelected(qgraphicsitem_cast<State *>(item)));
-                break;
-              case Transition::Type:
-                emit(transitionSelected(qgraphicsitem_cast<Transition *>(item)));
-                break;
-              default:
-                break;
-              }
-            }
+          statesMoved = false;
+          state = stateAt(mouseEvent->scenePos());
+          if ( state != NULL )
+            emit(stateSelected(state));
+          else if ( (transition = transitionAt(mouseEvent->scenePos())) != NULL )
+            emit(transitionSelected(transition));
           QGraphicsScene::mousePressEvent(mouseEvent);
           break;
        }
@@ -226,8 +394,11 @@ void Model::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
   if ( (mode == InsertTransition || mode == InsertPseudoState) && line != 0 ) {
     QLineF newLine(line->line().p1(), mouseEvent->scenePos());
     line->setLine(newLine);
+    State *target = stateAt(mouseEvent->scenePos());
+    setHoveredState(startState != NULL && target != startState ? target : NULL);
     }
   else if (mode == SelectItem) {
+    // The transitions of the moved states are updated once, by the deferred [updateTransitions]
     QGraphicsScene::mouseMoveEvent(mouseEvent);
     }
 }
@@ -235,32 +406,28 @@ void Model::mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)
 void Model::mouseReleaseEvent(QGraphicsSceneMouseEvent *mouseEvent)
 {
   if ( line != 0 && (mode == InsertTransition || mode == InsertPseudoState) ) {
-    QList<QGraphicsItem *> srcStates = items(line->line().p1());
-    if (srcStates.count() && srcStates.first() == line) srcStates.removeFirst();
-    QList<QGraphicsItem *> dstStates = items(line->line().p2());
-    if (dstStates.count() && dstStates.first() == line) dstStates.removeFirst();
+    State *srcState = startState;
+    State *dstState = stateAt(line->line().p2());
     removeItem(line);
     delete line;
-    if (srcStates.count() > 0 && dstStates.count() > 0 &&
-        srcStates.first()->type() == State::Type &&
-        dstStates.first()->type() == State::Type) {
-      State *srcState = qgraphicsitem_cast<State *>(srcStates.first());
-      State *dstState = qgraphicsitem_cast<State *>(dstStates.first());
-      if ( srcState != dstState ) {
-        State::Location location = srcState == dstState ? srcState->locateEvent(mouseEvent) : State::None;
-        Transition *transition = addTransition(srcState, dstState, "", location);
-        transition->updatePosition();
-        // emit transitionInserted(transition);
-        emit modelModified();
-        }
+    setHoveredState(NULL);
+    if ( srcState != NULL && dstState != NULL && srcState != dstState ) {
+      addTransition(srcState, dstState, "", State::None);
+      // emit transitionInserted(transition);
+      emit modelModified();
       }
     else if ( mode == InsertPseudoState && startState != NULL ) {
       // An initial pseudo-state has been created but not connected
-      removeItem(startState);
-      delete startState;
+      removeState(startState);
       }
     }
+  else if ( mode == SelectItem && statesMoved ) {
+    // Once per drag, not per mouse move
+    statesMoved = false;
+    emit modelModified();
+    }
   line = 0;
+  startState = NULL;
   QGraphicsScene::mouseReleaseEvent(mouseEvent);
 }
 
@@ -273,175 +440,106 @@ bool Model::isItemChange(int type)
     return false;
 }
 
-void Model::fromString(QString& json_text)
+void Model::fromGraph(const Graph& graph)
 {
-    auto json = nlohmann::json::parse(json_text.toStdString());
-
-    clear(); 
-    
-    QMap<std::string, State*> states;
+    clear();
     stateCounter = 0;
-
-    for ( auto json_state : json.at("states") ) {
-      std::string id = json_state.at("id");
-      State* state;
-      if ( id == State::initPseudoId.toStdString() )
-        state = addPseudoState(QPointF(json_state.at("x"), json_state.at("y")));
-      else 
-        state = addState(QPointF(json_state.at("x"), json_state.at("y")), QString::fromStdString(id));
-      states.insert(id, state);
+    QVector<State*> stateTable(graph.nodes().count());
+    for ( int n=0; n<graph.nodes().count(); n++ ) {
+      const Graph::Node& node = graph.nodes()[n];
+      QPointF pos(node.x, node.y);
+      stateTable[n] = node.pseudo ? addPseudoState(pos) : addState(pos, graph.nodeId(n));
       stateCounter++;
-      }   
-
-    for ( auto json_transition : json.at("transitions") ) {
-      std::string src_state = json_transition.at("src_state");
-      std::string dst_state = json_transition.at("dst_state");
-      std::string label = json_transition.at("label");
-      State::Location location;
-      switch ( (int)json_transition.at("location") ) {
-        case 1: location = State::North; break;
-        case 2: location = State::South; break;
-        case 3: location = State::East; break;
-        case 4: location = State::West; break;
-        default: location = State::None; break;
-        }
-      if ( ! states.contains(src_state) || ! states.contains(dst_state) )
-        throw std::invalid_argument("Model::fromString: invalid state id");
-      State *srcState = states.value(src_state);
-      State *dstState = states.value(dst_state);
-      Transition *transition = addTransition(srcState, dstState, QString::fromStdString(label), location);
-      transition->updatePosition();
       }
+    for ( int e=0; e<graph.edges().count(); e++ ) {
+      const Graph::Edge& edge = graph.edges()[e];
+      addTransition(stateTable[edge.src], stateTable[edge.dst], graph.edgeLabel(e), State::Location(edge.location));
+      }
+    updateTransitions();  // Each transition is laid out once, with its final rank in its bundle
+}
+
+Graph Model::toGraph() const
+{
+    Graph graph;
+    graph.reserve(states().count(), transitions().count());
+    QHash<State*,int> stateNumbers;
+    stateNumbers.reserve(states().count());
+    for ( const auto state: states() )
+      stateNumbers.insert(state, graph.addNode(state->getId(), state->scenePos().x(), state->scenePos().y()));
+    for ( const auto transition: transitions() )
+      graph.addEdge(stateNumbers.value(transition->srcState()), stateNumbers.value(transition->dstState()),
+                    transition->getLabel(), Graph::Location(transition->location()));
+    return graph;
+}
+
+void Model::fromJson(const char *data, qint64 size)
+{
+    Graph graph;
+    graph.fromJson(data, size);
+    fromGraph(graph);
+}
+
+void Model::load(const QString& fname)
+{
+    Graph graph;
+    graph.load(fname);
+    fromGraph(graph);
+}
+
+void Model::fromString(QString& json_text)
+{
+    QByteArray bytes = json_text.toUtf8();
+    fromJson(bytes.constData(), bytes.size());
+}
+
+int Model::View::edgeSrc(int e) const
+{
+    return model.stateRegistry.indexOf(model.transitions().at(e)->srcState());
+}
+
+int Model::View::edgeDst(int e) const
+{
+    return model.stateRegistry.indexOf(model.transitions().at(e)->dstState());
+}
+
+QString Model::View::edgeLabel(int e) const
+{
+    return model.transitions().at(e)->getLabel();
+}
+
+int Model::View::edgeLocation(int e) const
+{
+    return model.transitions().at(e)->location();
+}
+
+bool Model::toJson(QIODevice *device, bool compact)
+{
+    JsonSink sink(device, compact);
+    return exportGraph(View(*this), sink);
 }
 
 QString Model::toString()
 {
-    nlohmann::json json_res;
-
-    json_res["states"] = nlohmann::json::array();
-    for ( const auto item: items() ) {
-      if ( item->type() == State::Type ) {
-        State* state = qgraphicsitem_cast<State *>(item);
-        nlohmann::json json;
-        json["id"] = state->getId().toStdString(); 
-        json["x"] = state->scenePos().x(); 
-        json["y"] = state->scenePos().y(); 
-        json_res["states"].push_back(json);
-        }
-      }
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    toJson(&buffer);
+    return QString::fromUtf8(buffer.data());
+}
 
-    json_res["transitions"] = nlohmann::json::array();
-    for ( const auto item: items() ) {
-      if ( item->type() == Transition::Type ) {
-        Transition* transition = qgraphicsitem_cast<Transition *>(item);
-        nlohmann::json json;
-        json["src_state"] = transition->srcState()->getId().toStdString();
-        json["dst_state"] = transition->dstState()->getId().toStdString();
-        json["label"] = transition->getLabel().toStdString();
-        json["location"] = transition->location();
-        json_res["transitions"].push_back(json);
-        }
-      }
-    return QString::fromStdString(json_res.dump(2));
-}
-
-QString dotTransitionLabel(QString label, QString lrpad)
-{
-  QStringList l = label.split("/");
-  if ( l.length() != 2 ) return label;
-  int n = std::max(l.at(0).length(), l.at(1).length());
-  return lrpad + l.at(0) + lrpad
-       + "\n" + lrpad + QString(n, '_') + lrpad  + "\n"
-       + lrpad + l.at(1) + lrpad;
-}
-
-void Model::exportDot(QString fname)
-{
-  QFile file(fname);
-  file.open(QIODevice::WriteOnly | QIODevice::Text);
-  if ( file.error() != QFile::NoError ) {
-    QMessageBox::warning(mainWindow, "","Cannot open file " + file.fileName());
-    return;
-  }
-  QTextStream os(&file);
-  os << "digraph main {\n";
-  os << "layout = dot\n";
-  os << "rankdir = UD\n";
-  os << "size = \"8.5,11\"\n";
-  os << "center = 1\n";
-  os << "nodesep = \"0.350000\"\n";
-  os << "ranksep = \"0.400000\"\n";
-  os << "fontsize = 14\n";
-  os << "mindist=1.0\n";
-  for ( const auto item: items() ) {
-    if ( item->type() == State::Type ) {
-      State* state = qgraphicsitem_cast<State *>(item);
-      QString id = state->getId();
-      if ( state->isPseudo() ) 
-      os << id << " [shape=point]\n";
-      else
-        os << id << " [label=\"" << id << "\", shape=circle, style=solid]\n";
-      }
-    }
-  for ( const auto item: items() ) {
-    if ( item->type() == Transition::Type ) {
-      Transition* transition = qgraphicsitem_cast<Transition *>(item);
-      QString src_id = transition->srcState()->getId();
-      QString dst_id = transition->dstState()->getId();
-      QString label = dotTransitionLabel(transition->getLabel(),"");
-      if ( transition->isInitial() ) 
-        os << src_id << " -> " << dst_id << "\n";
-      else
-        os << src_id << " -> " << dst_id << " [label=\"" << label << "\"]\n";
-      }
-    }
-  os << "}\n";
-}
-
-void Model::renderDot(QGraphicsView *view, int width, int height)
-{
-  // TODO: factorize code with exportDot (?)
-  // Build scene
-  if ( scene ) delete scene; // QGraphicScene::clear does not reset the scene state :(
-  QGVScene* scene = new QGVScene("DOT", this);
-  scene->setSceneRect(QRectF(0, 0, width, height));
-  
-  scene->setGraphAttribute("rankdir", "UD");
-  scene->setGraphAttribute("nodesep", "0.55");
-  scene->setGraphAttribute("ranksep", "0.95");
-  scene->setGraphAttribute("fontsize", "14");
-  scene->setGraphAttribute("mindist", "1.0");
-  scene->setNodeAttribute("shape", "circle");
-  scene->setNodeAttribute("style", "solid");
-
-  QMap<QString,QGVNode*> nodes;
-
-  for ( const auto item: items() ) {
-    if ( item->type() == State::Type ) {
-      State* state = qgraphicsitem_cast<State *>(item);
-      QString id = state->getId();
-      QGVNode *node = scene->addNode(id);
-      if ( state->isPseudo() ) {
-        node->setAttribute("shape", "none"); 
-        node->setAttribute("label", "");
-        }
-      nodes.insert(id,node);
-      }
-    }
-  for ( const auto item: items() ) {
-    if ( item->type() == Transition::Type ) {
-      Transition* transition = qgraphicsitem_cast<Transition *>(item);
-      QString src_id = transition->srcState()->getId();
-      QString dst_id = transition->dstState()->getId();
-      QString label = transition->isInitial() ? "" : dotTransitionLabel(transition->getLabel(),"  ");
-      if ( nodes.contains(src_id) && nodes.contains(dst_id) ) {
-        scene->addEdge(nodes[src_id], nodes[dst_id], label);
-        }
-      }
-    }
-  // Render it in the specified view
-  scene->applyLayout();
-  view->setScene(scene);
-  view->ensureVisible(scene->itemsBoundingRect());
+bool Model::toBinary(QIODevice *device)
+{
+    return Graph::toBinary(View(*this), device);
+}
+
+bool Model::exportDot(QIODevice *device)
+{
+    DotSink sink(device);
+    return exportGraph(View(*this), sink);
+}
+
+bool Model::exportScxml(QIODevice *device)
+{
+    ScxmlSink sink(device);
+    return exportGraph(View(*this), sink);
 }
 
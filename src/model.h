@@ -16,8 +16,15 @@
 #include <QFile>
 #include <QTextStream>
 #include <QGraphicsScene>
+#include <QMultiHash>
+#include <QSet>
+#include <QPair>
 
 #include "state.h"
+#include "graph.h"
+#include "misc.h"
+#include "spatialindex.h"
+#include "edgerouter.h"
 
 QT_BEGIN_NAMESPACE
 class QGraphicsSceneMouseEvent;
@@ -35,22 +42,40 @@ public:
     enum Mode { InsertState, InsertPseudoState, InsertTransition, InsertLoopTransition, SelectItem, DeleteItem };
 
     explicit Model(QWidget *parent = 0);
+    void fromGraph(const Graph& graph);
+    Graph toGraph() const;
+    void load(const QString& fname);  // .fsd, .fsdb or .scxml, detected from the contents
+    void fromJson(const char *data, qint64 size);  // UTF-8 encoded .fsd contents
     void fromString(QString& json_text);
+    bool toJson(QIODevice *device, bool compact = false);
     QString toString();
+    bool toBinary(QIODevice *device);  // See fsdb.h
+    void clear();
 
-    void exportDot(QString fname);
-    void renderDot(QGraphicsView *view, int width, int height);
+    bool exportDot(QIODevice *device);
+    bool exportScxml(QIODevice *device);
 
-    State* initState();
-    QList<State*> states();
-    QList<Transition*> transitions();
+    State* initState() const { return pseudoState; }
+    const QList<State*>& states() const { return stateRegistry.items(); }
+    const QList<Transition*>& transitions() const { return transitionRegistry.items(); }
 
-    State* getState(QString id);
+    State* getState(const QString& id) const { return stateIndex.value(id, NULL); }
+    State* stateAt(QPointF pos) const;
     bool hasPseudoState();
+    void renameState(State* state, const QString& id);
+    void retargetTransition(Transition* transition, State* srcState, State* dstState);
+    void setTransitionLabel(Transition* transition, const QString& label);
+    void stateMoved(State* state);
+    bool isDuplicateId(const QString& id) const { return duplicateIds.contains(id); }
+    bool hasDuplicateIds() const { return ! duplicateIds.isEmpty(); }
+    EdgeRouter& edgeRouter() { return router; }
+
+    class View;
 
 public slots:
     void setMode(Mode mode);
     Mode getMode(void);
+    void updateTransitions();
 
 signals:
     // void stateInserted(State *item);
@@ -74,6 +99,33 @@ private:
     State* addState(QPointF pos, QString id);
     State* addPseudoState(QPointF pos);
     Transition* addTransition(State* srcState, State* dstState, QString label, State::Location location);
+    void removeState(State* state);
+    void removeTransition(Transition* transition);
+    Transition* transitionAt(QPointF pos);
+    void setHoveredState(State* state);
+    void indexState(State* state);
+    void unindexState(State* state);
+    void addToBundle(Transition* transition);
+    void removeFromBundle(Transition* transition);
+    void rankBundle(const QList<Transition*>& bundle);
+    void reroute(const QRectF& rect);
+    void scheduleUpdate();
+
+    Registry<State*> stateRegistry;
+    Registry<Transition*> transitionRegistry;
+    State *pseudoState;
+    QMultiHash<QString,State*> stateIndex;  // Several states may (temporarily) share the same id
+    QSet<QString> duplicateIds;
+    // Transitions linking the same two states, in either direction (self-transitions excluded)
+    QHash<QPair<State*,State*>,QList<Transition*> > bundles;  // In order of addition, for stable ranks
+    QSet<QPair<State*,State*> > dirtyBundles;  // To be ranked by the next call to [updateTransitions]
+    // Transitions whose geometry is to be recomputed by the next call to [updateTransitions]
+    QSet<Transition*> dirtyTransitions;
+    bool updatePending;
+    bool statesMoved;  // Since the last mouse press
+    SpatialIndex<State*> stateGrid;  // For hit-testing states and routing transitions
+    EdgeRouter router;
+    State *hoveredState;  // Candidate end state while drawing a transition
 
     Mode mode;
     QGraphicsLineItem *line;  // Line being drawn
@@ -83,8 +135,30 @@ private:
 
     static QColor lineColor;
     static QColor boxColor;
+};
 
-    QGraphicsScene *scene;
+// The model seen through the export interface, so that it is saved or exported without being
+// first copied into a [Graph]. States and transitions are numbered as in their registries
+
+class Model::View : public GraphView
+{
+public:
+    explicit View(const Model& model) : model(model) { }
+
+    int nbNodes() const override { return model.states().count(); }
+    int nbEdges() const override { return model.transitions().count(); }
+    QString nodeId(int n) const override { return model.states().at(n)->getId(); }
+    bool isPseudo(int n) const override { return model.states().at(n)->isPseudo(); }
+    double nodeX(int n) const override { return model.states().at(n)->scenePos().x(); }
+    double nodeY(int n) const override { return model.states().at(n)->scenePos().y(); }
+    int edgeSrc(int e) const override;
+    int edgeDst(int e) const override;
+    QString edgeLabel(int e) const override;
+    int edgeLocation(int e) const override;
+    int initNode() const override { return model.pseudoState != NULL ? model.stateRegistry.indexOf(model.pseudoState) : -1; }
+
+private:
+    const Model& model;
 };
 
 #endif // MODEL_H
@@ -138,6 +138,7 @@ void PropertiesPanel::setSelectedItem(State* state)
       selected_item = state;
       state_panel->show();
       state_name_field->setText(state->getId());
+      state_name_field->setStyleSheet(main_window->getModel()->isDuplicateId(state->getId()) ? "color: red" : "");
       }
 }
 
@@ -186,9 +187,11 @@ void PropertiesPanel::setStateName(const QString& name)
 {
     State* state = qgraphicsitem_cast<State*>(selected_item);
     if(state != nullptr) {
-        state->setId(name);
-        main_window->getModel()->update();
-        main_window->setUnsavedChanges(true);
+        Model* model = main_window->getModel();
+        model->renameState(state, name);
+        // Several states with the same name would make transition end-points ambiguous
+        state_name_field->setStyleSheet(model->isDuplicateId(name) ? "color: red" : "");
+        model->update();
     }
 }
 
@@ -201,9 +204,8 @@ void PropertiesPanel::setTransitionSrcState(int index)
   State* state = main_window->getModel()->getState(state_id);
   if ( state == nullptr )
     throw std::invalid_argument(std::string("No state found with id : ") + state_id.toStdString());
-  transition->setSrcState(state);
+  main_window->getModel()->retargetTransition(transition, state, transition->dstState());
   main_window->getModel()->update();
-  main_window->setUnsavedChanges(true);
 }
 
 void PropertiesPanel::setTransitionDstState(int index)  // TODO: factorize with above code
@@ -215,9 +217,8 @@ void PropertiesPanel::setTransitionDstState(int index)  // TODO: factorize with
   State* state = main_window->getModel()->getState(state_id);
   if ( state == nullptr )
     throw std::invalid_argument(std::string("No state found with id : ") + state_id.toStdString());
-  transition->setDstState(state);
+  main_window->getModel()->retargetTransition(transition, transition->srcState(), state);
   main_window->getModel()->update();
-  main_window->setUnsavedChanges(true);
 }
 
 void PropertiesPanel::setITransitionDstState(int index)  // TODO: factorize with above code
@@ -229,18 +230,16 @@ void PropertiesPanel::setITransitionDstState(int index)  // TODO: factorize with
   State* state = main_window->getModel()->getState(state_id);
   if ( state == nullptr )
     throw std::invalid_argument(std::string("No state found with id : ") + state_id.toStdString());
-  transition->setDstState(state);
+  main_window->getModel()->retargetTransition(transition, transition->srcState(), state);
   main_window->getModel()->update();
-  main_window->setUnsavedChanges(true);
 }
 
 void PropertiesPanel::setTransitionLabel(const QString& label)
 {
   Transition* transition = qgraphicsitem_cast<Transition*>(selected_item);
   if ( transition == nullptr ) return;
-  transition->setLabel(label);
+  main_window->getModel()->setTransitionLabel(transition, label);
   main_window->getModel()->update();
-  main_window->setUnsavedChanges(true);
 }
 
 void PropertiesPanel::clear()
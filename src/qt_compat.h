@@ -22,6 +22,7 @@
 #define POLYLINE_INTERSECT polyLine.intersects
 #define QSET_FROM_LIST(type,qlist) (QSet<type> (qlist.constBegin(), qlist.constEnd()))
 #define BUTTONGROUP_ID_CLICKED_SIGNAL SIGNAL(idClicked(int))
+#define HASH_ADD_DATA(hash,data,size) ((hash).addData(QByteArrayView((data),(size))))
 #else
 #define QT_ENDL endl
 #define SKIP_EMPTY_PARTS QString::SkipEmptyParts
@@ -32,4 +33,5 @@
 #define POLYLINE_INTERSECT polyLine.intersect
 #define QSET_FROM_LIST(type,qlist) (QSet<type>::fromList(qlist))
 #define BUTTONGROUP_ID_CLICKED_SIGNAL SIGNAL(buttonClicked(int))
+#define HASH_ADD_DATA(hash,data,size) ((hash).addData((data),(size)))
 #endif
@@ -0,0 +1,391 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#include "scenebench.h"
+#include "graph.h"
+#include "model.h"
+#include "state.h"
+#include "transition.h"
+#include "include/nlohmann_json.h"
+
+#include <QGuiApplication>
+#include <QImage>
+#include <QGraphicsSceneMouseEvent>
+#include <QPainter>
+#include <QRegion>
+#include <QElapsedTimer>
+#include <functional>
+#include <cmath>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+static const QSize viewSize(1920, 1080);
+static const double spacingX = 250, spacingY = 200;  // Between states
+static const int selectionSize = 1000;
+static const int hubSize = 10000;  // Transitions
+static const int denseSize = 5000;  // Transitions
+
+Graph SceneBench::generateGraph(int nbStates, double density, double longEdges)
+{
+  Graph graph;
+  int nbTransitions = qRound(nbStates * density);
+  int columns = qMax(1, (int)std::ceil(std::sqrt((double)nbStates)));
+  graph.reserve(nbStates + 1, nbTransitions + 1);
+  for ( int i=0; i<nbStates; i++ )
+    graph.addNode("S" + QString::number(i), (i % columns) * spacingX, (i / columns) * spacingY);
+  int init = graph.addNode(Graph::initPseudoId, -spacingX / 2, 0);
+  graph.addEdge(init, 0, "", Graph::None);
+  const int offsets[] = { 0, 1, -1, columns, -columns, columns + 1 };
+  quint32 longThreshold = (quint32)(qBound(0.0, longEdges, 1.0) * 65536);
+  quint32 seed = 1;  // Same diagram at each run
+  for ( int i=0; i<nbTransitions; i++ ) {
+    seed = seed * 1103515245 + 12345;
+    int src = i % nbStates;
+    int dst;
+    if ( ((seed >> 8) & 0xffff) < longThreshold ) {
+      seed = seed * 1103515245 + 12345;
+      dst = (seed >> 8) % nbStates;
+      }
+    else {
+      dst = src + offsets[(seed >> 16) % 6];
+      if ( dst < 0 || dst >= nbStates ) dst = src;
+      }
+    QString label = "e" + QString::number(i % 100) + "/a" + QString::number(i % 37);
+    graph.addEdge(src, dst, label, src == dst ? Graph::North : Graph::None);
+    }
+  return graph;
+}
+
+// Renders the [rect] part of the scene at its place in [image], which shows [view]
+
+static void paint(Model& model, QImage& image, const QRectF& view, const QRectF& rect)
+{
+  QPainter painter(&image);
+  QRectF target = rect.translated(-view.topLeft());
+  painter.fillRect(target, Qt::white);
+  model.render(&painter, target, rect);
+}
+
+static QRectF viewAround(QPointF center)
+{
+  QRectF view(QPointF(0, 0), QSizeF(viewSize));
+  view.moveCenter(center);
+  return view;
+}
+
+// Sends a left button event to the scene, as a view would
+
+static void sendMouseEvent(Model& model, QEvent::Type type, QPointF pos, QPointF buttonDownPos)
+{
+  QGraphicsSceneMouseEvent event(type);
+  event.setScenePos(pos);
+  event.setLastScenePos(pos);
+  event.setButtonDownScenePos(Qt::LeftButton, buttonDownPos);
+  event.setButton(type == QEvent::GraphicsSceneMouseMove ? Qt::NoButton : Qt::LeftButton);
+  event.setButtons(type == QEvent::GraphicsSceneMouseRelease ? Qt::NoButton : Qt::LeftButton);
+  QCoreApplication::sendEvent(&model, &event);
+}
+
+static json result(qint64 nsecs, qint64 pixels, int nbSteps)
+{
+  return json {
+    { "ms_per_step", nsecs / 1e6 / nbSteps },
+    { "pixels_per_step", (double)pixels / nbSteps },
+    { "within_frame_budget", nsecs / 1e6 / nbSteps < 16 }  // 60 frames per second
+  };
+}
+
+// Full repaints of a view centred on the diagram, at several zoom levels
+
+static json timeZoom(Model& model, QImage& image, int nbFrames)
+{
+  const qreal zooms[] = { 2, 1, 0.5, 0.25, 0.1, 0.05, 0.02 };
+  QPointF center = model.itemsBoundingRect().center();
+  json res = json::array();
+  for ( qreal zoom: zooms ) {
+    QRectF source(QPointF(0, 0), QSizeF(viewSize) / zoom);
+    source.moveCenter(center);
+    QElapsedTimer timer;
+    timer.start();
+    for ( int i=0; i<nbFrames; i++ ) {
+      QPainter painter(&image);
+      painter.fillRect(image.rect(), Qt::white);
+      model.render(&painter, image.rect(), source);
+      }
+    res.push_back({
+      { "zoom", zoom },
+      { "ms_per_frame", timer.nsecsElapsed() / 1e6 / nbFrames },
+      { "visible_items", model.items(source).count() }
+    });
+    }
+  return res;
+}
+
+// Times [nbSteps] calls to [step], each followed by the repainting of the parts of [view]
+// it changed
+
+static json timeSteps(Model& model, QImage& image, const QRectF& view, int nbSteps, std::function<void(int)> step)
+{
+  QCoreApplication::processEvents();  // Changes made before this case are not counted
+  paint(model, image, view, view);
+  QList<QRectF> changed;
+  QMetaObject::Connection connection = QObject::connect(&model, &QGraphicsScene::changed,
+      [&changed](const QList<QRectF>& rects) { changed += rects; });
+  qint64 pixels = 0;
+  QElapsedTimer timer;
+  timer.start();
+  for ( int i=0; i<nbSteps; i++ ) {
+    step(i);
+    QCoreApplication::processEvents();  // Runs the deferred update of the transitions
+    QCoreApplication::processEvents();  // Delivers the changed() notifications
+    QRegion region;
+    foreach ( const QRectF& rect, changed )
+      region += rect.intersected(view).toAlignedRect();
+    changed.clear();
+    for ( const QRect& rect: region ) {
+      pixels += (qint64)rect.width() * rect.height();
+      paint(model, image, view, rect);
+      }
+    }
+  qint64 nsecs = timer.nsecsElapsed();
+  QObject::disconnect(connection);
+  return result(nsecs, pixels, nbSteps);
+}
+
+// The state and transition accessors, against the scan of the scene items they replace,
+// on generated diagrams of increasing size
+
+static json timeRegistry(int nbSteps)
+{
+  const int sizes[] = { 1000, 10000, 100000 };
+  json res = json::array();
+  for ( int nbStates: sizes ) {
+    Model model;
+    model.fromGraph(SceneBench::generateGraph(nbStates, 1.0, 0.0));
+    qint64 count = 0;  // Keeps the loops from being optimized out
+    QElapsedTimer timer;
+    timer.start();
+    for ( int i=0; i<nbSteps; i++ ) {
+      QList<State*> states;
+      QList<Transition*> transitions;
+      foreach ( QGraphicsItem *item, model.items() ) {
+        if ( State *state = qgraphicsitem_cast<State *>(item) ) states.append(state);
+        else if ( Transition *transition = qgraphicsitem_cast<Transition *>(item) ) transitions.append(transition);
+        }
+      count += states.count() + transitions.count();
+      }
+    qint64 scanNsecs = timer.nsecsElapsed();
+    timer.restart();
+    for ( int i=0; i<nbSteps; i++ )
+      count += model.states().count() + model.transitions().count();
+    qint64 registryNsecs = timer.nsecsElapsed();
+    // Lookups by id, by a linear search of the states and through the index
+    const int nbLookups = 1000;
+    QStringList ids;
+    for ( int i=0; i<nbLookups; i++ ) ids.append("S" + QString::number((qint64)i * 7919 % nbStates));
+    timer.restart();
+    foreach ( const QString& id, ids )
+      foreach ( State *state, model.states() )
+        if ( state->getId() == id ) { count++; break; }
+    qint64 searchNsecs = timer.nsecsElapsed();
+    timer.restart();
+    foreach ( const QString& id, ids )
+      if ( model.getState(id) != NULL ) count++;
+    qint64 lookupNsecs = timer.nsecsElapsed();
+    res.push_back({
+      { "states", nbStates },
+      { "scene_items", model.items().count() },
+      { "scan_ms", scanNsecs / 1e6 / nbSteps },
+      { "registry_ms", registryNsecs / 1e6 / nbSteps },
+      { "search_us_per_lookup", searchNsecs / 1e3 / nbLookups },
+      { "index_us_per_lookup", lookupNsecs / 1e3 / nbLookups },
+      { "checksum", count }
+    });
+    }
+  return res;
+}
+
+// The deletion, through the editing view, of a hub state with [nbTransitions] transitions,
+// half of them incoming, to as many distinct states
+
+static json timeHubDelete(int nbTransitions)
+{
+  Graph graph;
+  int columns = qMax(1, (int)std::ceil(std::sqrt((double)nbTransitions)));
+  graph.reserve(nbTransitions + 1, nbTransitions);
+  int hub = graph.addNode("hub", -spacingX, -spacingY);
+  for ( int i=0; i<nbTransitions; i++ ) {
+    int peer = graph.addNode("S" + QString::number(i), (i % columns) * spacingX, (i / columns) * spacingY);
+    if ( i % 2 == 0 )
+      graph.addEdge(hub, peer, "e", Graph::None);
+    else
+      graph.addEdge(peer, hub, "e", Graph::None);
+    }
+  Model model;
+  model.fromGraph(graph);
+  QCoreApplication::processEvents();
+  State *state = model.getState("hub");
+  model.setMode(Model::DeleteItem);
+  QElapsedTimer timer;
+  timer.start();
+  sendMouseEvent(model, QEvent::GraphicsSceneMousePress, state->pos(), state->pos());
+  qint64 nsecs = timer.nsecsElapsed();
+  return json {
+    { "transitions", nbTransitions },
+    { "ms", nsecs / 1e6 },
+    { "deleted", model.getState("hub") == NULL && model.transitions().isEmpty() }
+  };
+}
+
+// Full repaints of a dense diagram of [nbTransitions] transitions, with the geometry of the
+// transitions cached, then recomputed before each frame, as when it was computed while painting
+
+static json timeGeometry(QImage& image, int nbTransitions, double longEdges, int nbFrames)
+{
+  Model model;
+  model.fromGraph(SceneBench::generateGraph(nbTransitions / 2, 2.0, longEdges));
+  QCoreApplication::processEvents();
+  QRectF source = model.itemsBoundingRect();
+  auto repaint = [&]() {
+    QPainter painter(&image);
+    painter.fillRect(image.rect(), Qt::white);
+    model.render(&painter, image.rect(), source);
+  };
+  QElapsedTimer timer;
+  timer.start();
+  for ( int i=0; i<nbFrames; i++ )
+    repaint();
+  qint64 cachedNsecs = timer.nsecsElapsed();
+  timer.restart();
+  for ( int i=0; i<nbFrames; i++ ) {
+    foreach ( Transition *transition, model.transitions() )
+      transition->updatePosition();
+    repaint();
+    }
+  qint64 recomputedNsecs = timer.nsecsElapsed();
+  return json {
+    { "transitions", model.transitions().count() },
+    { "cached_ms_per_frame", cachedNsecs / 1e6 / nbFrames },
+    { "recomputed_ms_per_frame", recomputedNsecs / 1e6 / nbFrames }
+  };
+}
+
+// Back and forth, so that the diagram is left as it was
+static QPointF dragStep(int i, int nbSteps)
+{
+  return QPointF(i < nbSteps / 2 ? 4 : -4, i < nbSteps / 2 ? 2 : -2);
+}
+
+QByteArray SceneBench::run(const Options& options)
+{
+  Model model;
+  QElapsedTimer timer;
+  timer.start();
+  if ( options.input.isEmpty() )
+    model.fromGraph(generateGraph(options.nbStates, options.density, options.longEdges));
+  else
+    model.load(options.input);
+  qint64 loadNsecs = timer.nsecsElapsed();
+  QCoreApplication::processEvents();
+
+  QImage image(viewSize, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::white);
+  int nbSteps = options.nbSteps;
+
+  // The most connected state is dragged, by small steps as with the mouse
+  QList<State*> states;
+  State *dragged = NULL;
+  foreach ( State *state, model.states() ) {
+    if ( state->isPseudo() ) continue;
+    states.append(state);
+    if ( dragged == NULL || state->getTransitions().count() > dragged->getTransitions().count() )
+      dragged = state;
+    }
+  if ( dragged == NULL ) throw std::invalid_argument("no state to drag");
+  QRectF draggedView = viewAround(dragged->pos());
+
+  json cases;
+  cases["zoom"] = timeZoom(model, image, nbSteps);
+
+  json stateDrag = timeSteps(model, image, draggedView, nbSteps, [&](int i) {
+    dragged->setPos(dragged->pos() + dragStep(i, nbSteps));
+  });
+  stateDrag["transitions"] = dragged->getTransitions().count();
+  cases["state_drag"] = stateDrag;
+
+  QList<State*> selection = states.mid(0, selectionSize);
+  QRectF selectionRect;
+  foreach ( State *state, selection ) {
+    state->setSelected(true);
+    selectionRect |= state->sceneBoundingRect();
+    }
+  // The selection is dragged with the mouse, as in the editor, so that the moves go through
+  // Model::mouseMoveEvent and the deferred update of the transitions
+  QPointF grab = selection.first()->pos();
+  QPointF mouse = grab;
+  sendMouseEvent(model, QEvent::GraphicsSceneMousePress, grab, grab);
+  json selectionDrag = timeSteps(model, image, viewAround(selectionRect.center()), nbSteps, [&](int i) {
+    mouse += dragStep(i, nbSteps);
+    sendMouseEvent(model, QEvent::GraphicsSceneMouseMove, mouse, grab);
+  });
+  // Without repainting, and with several moves per turn of the event loop, as when the mouse
+  // rate exceeds the frame rate
+  const int movesPerTurn = 4;
+  timer.restart();
+  for ( int i=0; i<nbSteps; i++ ) {
+    for ( int j=0; j<movesPerTurn; j++ ) {
+      mouse += dragStep(i, nbSteps) / movesPerTurn;
+      sendMouseEvent(model, QEvent::GraphicsSceneMouseMove, mouse, grab);
+      }
+    QCoreApplication::processEvents();
+    }
+  qint64 movesNsecs = timer.nsecsElapsed();
+  sendMouseEvent(model, QEvent::GraphicsSceneMouseRelease, mouse, grab);
+  QCoreApplication::processEvents();
+  selectionDrag["states"] = selection.count();
+  selectionDrag["moves_per_sec"] = movesNsecs > 0 ? nbSteps * movesPerTurn * 1e9 / movesNsecs : 0.0;
+  cases["selection_drag"] = selectionDrag;
+  model.clearSelection();
+
+  QList<Transition*> edited;
+  foreach ( QGraphicsItem *item, model.items(draggedView) ) {
+    Transition *transition = qgraphicsitem_cast<Transition *>(item);
+    if ( transition != NULL && ! transition->isInitial() ) edited.append(transition);
+    }
+  if ( ! edited.isEmpty() )
+    cases["label_edit"] = timeSteps(model, image, draggedView, nbSteps, [&](int i) {
+      // Each step edits one label, then the next one puts it back
+      Transition *transition = edited.at((i / 2) % edited.count());
+      QString label = transition->getLabel();
+      model.setTransitionLabel(transition, i % 2 == 0 ? label + "_x" : label.left(label.length() - 2));
+    });
+
+  cases["geometry"] = timeGeometry(image, denseSize, options.longEdges, nbSteps);
+  cases["registry"] = timeRegistry(nbSteps);
+  cases["hub_delete"] = timeHubDelete(hubSize);
+
+  json results = {
+    { "qt_version", qVersion() },
+    { "platform", QGuiApplication::platformName().toStdString() },
+    { "input", options.input.isEmpty() ? "generated" : options.input.toStdString() },
+    { "states", states.count() },
+    { "transitions", model.transitions().count() },
+    { "long_edges", options.input.isEmpty() ? options.longEdges : 0.0 },
+    { "scene_items", model.items().count() },
+    { "view", { viewSize.width(), viewSize.height() } },
+    { "steps", nbSteps },
+    { "load_ms", loadNsecs / 1e6 },
+    { "cases", cases }
+  };
+  return QByteArray::fromStdString(results.dump(2) + "\n");
+}
@@ -0,0 +1,55 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef SCENEBENCH_H
+#define SCENEBENCH_H
+
+#include <QByteArray>
+#include <QString>
+#include "graph.h"
+
+// Rendering benchmarks on the editing scene.
+//
+// A diagram is read or generated, loaded in a [Model] and rendered, through QGraphicsScene::render,
+// in an image standing for a 1920x1080 editing view. The timed cases are
+//   zoom            full repaints of the view at several zoom levels
+//   state_drag      the drag of the most connected state
+//   selection_drag  the drag of a selection of (at most) 1000 states
+//   label_edit      the edition of transition labels
+//   geometry        full repaints of a 5k transitions diagram, with and without its geometry cached
+//   registry        the state and transition accessors, on diagrams of 1k, 10k and 100k states
+//   hub_delete      the deletion of a state with 10k transitions
+// After each step of the drag and edit cases, only the parts of the view reported as changed by
+// the scene are repainted, as a view does in MinimalViewportUpdate mode, and the number of
+// pixels repainted is counted.
+//
+// An application object must exist (the "offscreen" platform is enough).
+
+namespace SceneBench {
+  struct Options {
+    QString input;            // Diagram file; generated if empty
+    int nbStates = 2000;
+    double density = 2.0;     // Transitions per state
+    double longEdges = 0.05;  // Proportion of transitions to a random, usually far, state
+    int nbSteps = 50;         // Frames or steps per case
+  };
+
+  // States on a square grid. Transitions mostly link neighbouring states, as in hand-drawn
+  // diagrams, and share a limited set of labels. The same arguments give the same diagram
+  Graph generateGraph(int nbStates, double density, double longEdges);
+
+  // Runs all the cases and returns the results as a JSON document.
+  // Throws std::exception when the input file cannot be read
+  QByteArray run(const Options& options);
+}
+
+#endif // SCENEBENCH_H
@@ -0,0 +1,227 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+// Reading and writing diagrams in the SCXML format (see scxml.h)
+
+#include "scxml.h"
+#include "graph.h"
+#include "qt_compat.h"
+
+#include <QXmlStreamReader>
+#include <QList>
+#include <QStringList>
+#include <QRegularExpression>
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+
+static QString exact(double v)
+{
+  return QString::number(v, 'g', 17);  // Exact
+}
+
+ScxmlSink::ScxmlSink(QIODevice *device) : os(device)
+{
+  os.setAutoFormatting(true);
+  os.setAutoFormattingIndent(2);
+}
+
+void ScxmlSink::begin(const GraphView& graph)
+{
+  // Counting sort of the edges by source node
+  int nbNodes = graph.nbNodes();
+  int nbEdges = graph.nbEdges();
+  firstEdge.fill(0, nbNodes + 1);
+  for ( int e=0; e<nbEdges; e++ ) firstEdge[graph.edgeSrc(e) + 1]++;
+  for ( int n=0; n<nbNodes; n++ ) firstEdge[n+1] += firstEdge[n];
+  outEdges.resize(nbEdges);
+  QVector<int> next = firstEdge;
+  for ( int e=0; e<nbEdges; e++ )
+    outEdges[next[graph.edgeSrc(e)]++] = e;
+
+  os.writeStartDocument();
+  os.writeDefaultNamespace(Scxml::ns);
+  os.writeNamespace(Scxml::ssdeNs, "ssde");
+  os.writeStartElement(Scxml::ns, "scxml");
+  os.writeAttribute("version", "1.0");
+  int init = graph.initNode();
+  if ( init >= 0 ) {
+    if ( firstEdge[init] < firstEdge[init+1] )
+      os.writeAttribute("initial", graph.nodeId(graph.edgeDst(outEdges[firstEdge[init]])));
+    os.writeAttribute(Scxml::ssdeNs, "initial-x", exact(graph.nodeX(init)));
+    os.writeAttribute(Scxml::ssdeNs, "initial-y", exact(graph.nodeY(init)));
+    }
+}
+
+void ScxmlSink::node(const GraphView& graph, int n)
+{
+  if ( graph.isPseudo(n) ) return;  // Described by the attributes of <scxml>
+  os.writeStartElement(Scxml::ns, "state");
+  os.writeAttribute("id", graph.nodeId(n));
+  os.writeAttribute(Scxml::ssdeNs, "x", exact(graph.nodeX(n)));
+  os.writeAttribute(Scxml::ssdeNs, "y", exact(graph.nodeY(n)));
+  for ( int i=firstEdge[n]; i<firstEdge[n+1]; i++ ) {
+    int e = outEdges[i];
+    int location = graph.edgeLocation(e);
+    QString event, action;
+    bool hasAction = Graph::splitLabel(graph.edgeLabel(e), event, action);
+    os.writeStartElement(Scxml::ns, "transition");
+    if ( ! event.isEmpty() ) os.writeAttribute("event", event);
+    os.writeAttribute("target", graph.nodeId(graph.edgeDst(e)));
+    if ( location != Graph::None ) os.writeAttribute(Scxml::ssdeNs, "location", QString::number(location));
+    if ( hasAction ) os.writeTextElement(Scxml::ns, "script", action);
+    os.writeEndElement();
+    }
+  os.writeEndElement();
+}
+
+bool ScxmlSink::end(const GraphView&)
+{
+  os.writeEndElement();
+  os.writeEndDocument();
+  return ! os.hasError();
+}
+
+bool Graph::toScxml(QIODevice *device) const
+{
+  ScxmlSink sink(device);
+  return exportGraph(*this, sink);
+}
+
+bool Graph::isScxml(const char *data, qint64 size)
+{
+  qint64 start = size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;  // UTF-8 BOM
+  for ( qint64 i=start; i<size; i++ ) {
+    char c = data[i];
+    if ( c == ' ' || c == '\t' || c == '\r' || c == '\n' ) continue;
+    return c == '<';
+    }
+  return false;
+}
+
+static void invalid(const QXmlStreamReader& is, const QString& msg)
+{
+  throw std::invalid_argument(QString("Graph::fromScxml: line %1: %2").arg(is.lineNumber()).arg(msg).toStdString());
+}
+
+// Value of a ssde:[name] attribute
+static double number(QXmlStreamReader& is, const char *name, double defaultValue)
+{
+  auto v = is.attributes().value(Scxml::ssdeNs, name);
+  if ( v.isEmpty() ) return defaultValue;
+  bool ok;
+  double x = v.toDouble(&ok);
+  if ( ! ok ) invalid(is, QString("invalid value for ssde:") + name);
+  return x;
+}
+
+// States are added as soon as their start tag is read, and their transitions as soon as they
+// are complete. Transitions are only buffered when they refer to a state not read yet
+
+void Graph::fromScxml(const char *data, qint64 size)
+{
+  struct Pending { int src; QString target, label; Location location; };
+
+  // The reader works on a QByteArray, whose size is an int with Qt 5
+  if ( size > std::numeric_limits<int>::max() ) throw std::invalid_argument("Graph::fromScxml: file too large");
+  clear();
+  QXmlStreamReader is(QByteArray::fromRawData(data, (int)size));
+  QList<int> parents;  // Enclosing states
+  QList<Pending> pending;
+  QString initial;
+  double initX = 0, initY = 0;
+  bool hasInitPos = false;
+  bool inScxml = false;
+  // Current transition
+  int src = -1;
+  QString event, action;
+  QStringList targets;
+  bool hasAction = false;
+  Location location = None;
+
+  while ( ! is.atEnd() ) {
+    QXmlStreamReader::TokenType token = is.readNext();
+    if ( token == QXmlStreamReader::StartElement ) {
+      if ( is.namespaceUri() != QLatin1String(Scxml::ns) ) { is.skipCurrentElement(); continue; }
+      auto name = is.name();
+      if ( name == QLatin1String("scxml") ) {
+        inScxml = true;
+        initial = is.attributes().value("initial").toString();
+        hasInitPos = is.attributes().hasAttribute(Scxml::ssdeNs, "initial-x");
+        initX = number(is, "initial-x", 0);
+        initY = number(is, "initial-y", 0);
+        }
+      else if ( ! inScxml )
+        invalid(is, "not a SCXML document");
+      else if ( name == QLatin1String("state") || name == QLatin1String("final") ) {
+        QString id = is.attributes().value("id").toString();
+        if ( id.isEmpty() ) invalid(is, "missing state id");
+        // States with no position are lined up
+        int i = nodeTable.count();
+        parents.append(addNode(id, number(is, "x", (i % 10) * 150.0), number(is, "y", (i / 10) * 150.0)));
+        }
+      else if ( name == QLatin1String("initial") || name == QLatin1String("history") ) {
+        // Their transitions designate (flattened) substates, not transitions between states
+        is.skipCurrentElement();
+        }
+      else if ( name == QLatin1String("transition") ) {
+        targets = is.attributes().value("target").toString().split(QRegularExpression("\\s+"), SKIP_EMPTY_PARTS);
+        // Targetless transitions do not change the state
+        if ( parents.isEmpty() || targets.isEmpty() ) { is.skipCurrentElement(); continue; }
+        src = parents.last();
+        event = is.attributes().value("event").toString();
+        int loc = (int)number(is, "location", None);
+        if ( loc < None || loc > West ) invalid(is, "invalid location");
+        location = Location(loc);
+        action.clear();
+        hasAction = false;
+        }
+      else if ( name == QLatin1String("script") && src >= 0 ) {
+        action += is.readElementText();
+        hasAction = true;
+        }
+      // Other elements are read through, so that the states they contain are not lost
+      }
+    else if ( token == QXmlStreamReader::EndElement && is.namespaceUri() == QLatin1String(Scxml::ns) ) {
+      auto name = is.name();
+      if ( name == QLatin1String("state") || name == QLatin1String("final") )
+        parents.removeLast();
+      else if ( name == QLatin1String("transition") && src >= 0 ) {
+        QString label = hasAction ? event + "/" + action : event;
+        // With nested states flattened, a transition to several (parallel) states becomes
+        // one transition to each of them
+        for ( const QString& target: targets ) {
+          int dst = nodeIndex(target);
+          if ( dst >= 0 )
+            addEdge(src, dst, label, location);
+          else
+            pending.append(Pending { src, target, label, location });
+          }
+        src = -1;
+        }
+      }
+    }
+  if ( is.hasError() ) invalid(is, is.errorString());
+  if ( ! inScxml ) invalid(is, "not a SCXML document");
+
+  for ( const Pending& p: pending ) {
+    int dst = nodeIndex(p.target);
+    if ( dst < 0 ) throw std::invalid_argument("Graph::fromScxml: invalid state id: " + p.target.toStdString());
+    addEdge(p.src, dst, p.label, p.location);
+    }
+  if ( ! initial.isEmpty() ) {
+    int dst = nodeIndex(initial);
+    if ( dst < 0 ) throw std::invalid_argument("Graph::fromScxml: invalid initial state: " + initial.toStdString());
+    if ( ! hasInitPos ) { initX = nodeTable[dst].x - 60; initY = nodeTable[dst].y; }
+    addEdge(addNode(initPseudoId, initX, initY), dst, "", None);
+    }
+}
@@ -0,0 +1,57 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef SCXML_H
+#define SCXML_H
+
+#include <QXmlStreamWriter>
+#include "exporter.h"
+
+// SCXML (https://www.w3.org/TR/scxml/) mapping
+//
+//   diagram              <scxml>, with the target of the initial transition, if any, as [initial]
+//   state                <state id=...>
+//   transition           <transition> child of its source state, with [target]
+//   label "event/action" [event] attribute and a <script> element holding the action
+//   label "event"        [event] attribute only (as any label not split by Graph::splitLabel)
+//
+// Editor data with no SCXML equivalent (positions, locations of self-transitions) are kept in
+// attributes of the "ssde" namespace, so that a diagram saved as SCXML can be read back as is.
+// Other SCXML constructs are ignored when reading; nested states are flattened. Hence transitions
+// with no target, and those of <initial> and <history> elements, are ignored, and a transition
+// with several targets gives one transition to each of them.
+
+namespace Scxml {
+  const char ns[] = "http://www.w3.org/2005/07/scxml";
+  const char ssdeNs[] = "https://github.com/jserot/ssde";
+}
+
+// States are written one at a time, each with its outgoing transitions. This requires an index of
+// the transitions by source state (two integers per transition), built at the start
+
+class ScxmlSink : public ExportSink
+{
+public:
+    explicit ScxmlSink(QIODevice *device);
+
+    void begin(const GraphView& graph) override;
+    void node(const GraphView& graph, int n) override;
+    void edge(const GraphView&, int) override { }
+    bool end(const GraphView& graph) override;
+
+private:
+    QXmlStreamWriter os;
+    QVector<int> firstEdge;  // By source node: index in [outEdges] of its first outgoing edge
+    QVector<int> outEdges;   // Edges, grouped by source node
+};
+
+#endif // SCXML_H
@@ -0,0 +1,113 @@
+/***********************************************************************/
+/*                                                                     */
+/* This file is part of the SSDE (Simple State Diagram Editor) package */
+/*                                                                     */
+/*  Copyright (c) 2019-present, Jocelyn SEROT (jocelyn.serot@uca.fr)   */
+/*                       All rights reserved.                          */
+/*                                                                     */
+/*    This source code is licensed under the license found in the      */
+/*      LICENSE file in the root directory of this source tree.        */
+/*                                                                     */
+/***********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QRectF>
+#include <QPointF>
+#include <cmath>
+#include <algorithm>
+
+// A uniform grid of square cells, indexing items by their (scene) bounding rect.
+// Each item is recorded in every cell its rect overlaps. With cells larger than
+// the indexed items, a point query only looks at the few items of a single cell,
+// whatever the number of items.
+
+template <typename T>
+class SpatialIndex
+{
+public:
+  explicit SpatialIndex(qreal cellSize = 128) : cellSize(cellSize), counter(0) { }
+
+  // Moving an item (inserting it again) keeps its rank in the insertion order
+  void insert(T item, const QRectF& rect)
+  {
+    quint64 seq = entries.contains(item) ? entries.value(item).seq : counter++;
+    if ( entries.contains(item) ) remove(item);
+    Entry& e = entries[item];
+    e.rect = rect;
+    e.seq = seq;
+    forEachCell(rect, [&](quint64 key) { cells[key].append(item); e.cells.append(key); });
+  }
+
+  void remove(T item)
+  {
+    auto it = entries.find(item);
+    if ( it == entries.end() ) return;
+    for ( quint64 key : it->cells ) {
+      auto c = cells.find(key);
+      c->removeOne(item);
+      if ( c->isEmpty() ) cells.erase(c);
+      }
+    entries.erase(it);
+  }
+
+  bool contains(T item) const { return entries.contains(item); }
+  QRectF rect(T item) const { auto it = entries.find(item); return it != entries.end() ? it->rect : QRectF(); }
+
+  // Returns the items whose rect contains [p], in insertion order
+  QList<T> itemsAt(const QPointF& p) const
+  {
+    QList<T> res;
+    auto c = cells.find(cellKey(cellOf(p.x()), cellOf(p.y())));
+    if ( c == cells.end() ) return res;
+    for ( T item : *c )
+      if ( rect(item).contains(p) ) res.append(item);
+    std::sort(res.begin(), res.end(), [this](T a, T b) { return entries.value(a).seq < entries.value(b).seq; });
+    return res;
+  }
+
+  // Returns all the items whose rect intersects [r], each one once
+  QList<T> intersecting(const QRectF& r) const
+  {
+    QList<T> res;
+    QSet<T> seen;
+    forEachCell(r, [&](quint64 key) {
+      auto c = cells.find(key);
+      if ( c == cells.end() ) return;
+      for ( T item : *c ) {
+        if ( seen.contains(item) ) continue;
+        seen.insert(item);
+        if ( rect(item).intersects(r) ) res.append(item);
+        }
+      });
+    return res;
+  }
+
+  void clear() { cells.clear(); entries.clear(); counter = 0; }
+
+private:
+  struct Entry {
+    QRectF rect;
+    QList<quint64> cells;
+    quint64 seq;  // Rank in the insertion order
+  };
+
+  qreal cellSize;
+  quint64 counter;
+  QHash<quint64, QList<T> > cells;
+  QHash<T, Entry> entries;
+
+  qint32 cellOf(qreal v) const { return (qint32)std::floor(v / cellSize); }
+  static quint64 cellKey(qint32 i, qint32 j) { return ((quint64)(quint32)i << 32) | (quint32)j; }
+
+  template <typename F>
+  void forEachCell(const QRectF& r, F f) const
+  {
+    for ( qint32 i=cellOf(r.left()); i<=cellOf(r.right()); i++ )
+      for ( qint32 j=cellOf(r.top()); j<=cellOf(r.bottom()); j++ )
+        f(cellKey(i, j));
+  }
+};
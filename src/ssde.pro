@@ -8,24 +8,45 @@ QMAKE_MACOSX_DEPLOYMENT_TARGET = 12.6
 TARGET = ssde
 TEMPLATE = app
 
-INCLUDEPATH += $$QGVLIBDIR
-LIBS += -L$$QGVLIBDIR -lQGVCore
-DEPENDPATH += $$QGVLIBDIR
-
 !include(./GraphViz.pri) { error("Cannot open GraphViz.pri file") }
 
 HEADERS += include/nlohmann_json.h \
            qt_compat.h \
+           misc.h \
+           lod.h \
+           graph.h \
+           graphview.h \
+           spatialindex.h \
+           edgerouter.h \
+           bufferedwriter.h \
+           fsdb.h \
+           exporter.h \
+           scxml.h \
+           dotlayout.h \
+           dotrenderer.h \
+           layoutcache.h \
            transition.h  \
            state.h  \
            model.h  \
            properties.h \
-           mainwindow.h
+           mainwindow.h \
+           cli.h \
+           scenebench.h
 SOURCES += transition.cpp \
            state.cpp \
            model.cpp \
+           graph.cpp \
+           fsdb.cpp \
+           exporter.cpp \
+           scxml.cpp \
+           dotlayout.cpp \
+           dotrenderer.cpp \
+           layoutcache.cpp \
+           edgerouter.cpp \
            properties.cpp \
            mainwindow.cpp \
+           cli.cpp \
+           scenebench.cpp \
            main.cpp
 
 RESOURCES += resources.qrc
@@ -12,10 +12,13 @@
 
 #include "state.h"
 #include "transition.h"
+#include "model.h"
+#include "lod.h"
 
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QDebug>
 
 QSize State::dskSize = QSize(15,15);
@@ -23,7 +26,8 @@ QSize State::boxSize = QSize(100,70);
 QColor State::boxBackground = Qt::white;
 QColor State::selectedColor = Qt::darkCyan;
 QColor State::unSelectedColor = Qt::black;
-QString State::initPseudoId = "_init";
+QColor State::highlightedColor = Qt::darkGreen;
+QString State::initPseudoId = Graph::initPseudoId;
 
 State::State(QString id, QGraphicsItem *parent)
     : QGraphicsPolygonItem(parent)
@@ -35,11 +39,14 @@ State::State(QString id, QGraphicsItem *parent)
               << QPointF(-boxSize.width()/2, boxSize.height()/2)  // P4-----P3
               << QPointF(-boxSize.width()/2, -boxSize.height()/2);
     setPolygon(myPolygon);
+    myShape.addPolygon(myPolygon);
     setFlag(QGraphicsItem::ItemIsMovable, true);
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
-    this->id = id;
+    myIdText.setTextFormat(Qt::PlainText);
+    setId(id);
     isPseudoState = false;
+    isHighlighted = false;
 }
 
 State::State(QGraphicsItem *parent)
@@ -52,76 +59,121 @@ State::State(QGraphicsItem *parent)
               << QPointF(-dskSize.width()/2, dskSize.height()/2)
               << QPointF(-dskSize.width()/2, -dskSize.height()/2);
     setPolygon(myPolygon);
+    myShape.addEllipse(myPolygon.boundingRect());
     setFlag(QGraphicsItem::ItemIsMovable, true);
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
     this->id = initPseudoId;
     isPseudoState = true;
+    isHighlighted = false;
 }
 
+void State::setId(QString id)
+{
+  this->id = id;
+  myIdText.setText(id);
+  update();
+}
 
 void State::removeTransition(Transition *transition)
 {
-    int index = transitions.indexOf(transition);
+    if (transition->srcState() == this) {
+        auto it = outgoing.find(transition->dstState());
+        if (it != outgoing.end()) {
+            it->remove(transition);
+            if (it->isEmpty()) outgoing.erase(it);
+        }
+    }
+    if (transition->dstState() == this) {
+        auto it = incoming.find(transition->srcState());
+        if (it != incoming.end()) {
+            it->remove(transition);
+            if (it->isEmpty()) incoming.erase(it);
+        }
+    }
+}
 
-    if (index != -1)
-        transitions.removeAt(index);
+void State::addTransition(Transition *transition)
+{
+    if (transition->srcState() == this)
+        outgoing[transition->dstState()].insert(transition);
+    if (transition->dstState() == this)
+        incoming[transition->srcState()].insert(transition);
 }
 
-void State::removeTransitions()
+QList<Transition*> State::getTransitions() const
 {
-    foreach (Transition *transition, transitions) {
-        transition->srcState()->removeTransition(transition);
-        transition->dstState()->removeTransition(transition);
-        scene()->removeItem(transition);
-        delete transition;
-    }
+  QList<Transition *> res;
+  for ( auto it = outgoing.constBegin(); it != outgoing.constEnd(); ++it )
+    for ( auto a : it.value() ) res.append(a);
+  for ( auto it = incoming.constBegin(); it != incoming.constEnd(); ++it )
+    if ( it.key() != this ) // Self-transitions have already been collected
+      for ( auto a : it.value() ) res.append(a);
+  return res;
 }
 
-void State::addTransition(Transition *transition)
+void State::collectTransitions(QSet<Transition*>& res) const
+{
+  for ( auto it = outgoing.constBegin(); it != outgoing.constEnd(); ++it )
+    res.unite(it.value());
+  for ( auto it = incoming.constBegin(); it != incoming.constEnd(); ++it )
+    res.unite(it.value());
+}
+
+void State::setHighlighted(bool highlighted)
 {
-    transitions.append(transition);
+  if ( highlighted == isHighlighted ) return;
+  isHighlighted = highlighted;
+  update();
 }
 
-void State::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+void State::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
 {
+  qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+  if ( lod < Lod::outline ) {
+    // A few pixels wide : the outline and id would not show anyway
+    painter->fillRect(myPolygon.boundingRect(), isPseudoState ? Qt::black : isSelected() ? selectedColor : unSelectedColor);
+    return;
+    }
   painter->setRenderHint(QPainter::Antialiasing);
   if ( isPseudoState ) {
     painter->setBrush(Qt::black);
     painter->drawEllipse(myPolygon.boundingRect());
     }
   else {
-    painter->setPen(QPen(isSelected() ? selectedColor : unSelectedColor, 1));
+    painter->setPen(QPen(isSelected() ? selectedColor : isHighlighted ? highlightedColor : unSelectedColor, 1));
     painter->setBrush(boxBackground);
     painter->drawPolygon(myPolygon);
-    painter->drawText(boundingRect(), Qt::AlignHCenter | Qt::AlignVCenter, id);
+    if ( lod >= Lod::text ) {
+      QSizeF size = myIdText.size();
+      painter->drawStaticText(QPointF(-size.width()/2, -size.height()/2), myIdText);
+      }
     }
 }
 
 QVariant State::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    if (change == QGraphicsItem::ItemPositionChange) {
-        foreach (Transition *transition, transitions) {
-            transition->updatePosition();
-        }
+    if (change == QGraphicsItem::ItemPositionHasChanged) {
+        // When part of a model, the update of attached transitions is deferred, so that
+        // moving several states at once updates each transition only once
+        Model *model = qobject_cast<Model *>(scene());
+        if (model != NULL)
+            model->stateMoved(this);
+        else
+            foreach (Transition *transition, getTransitions())
+                transition->updatePosition();
     }
     return value;
 }
 
 QList<Transition*> State::getTransitionsTo(State* dstState)
 {
-  QList<Transition *> res;
-  for ( auto a : transitions ) 
-    if ( a->dstState() == dstState ) res.append(a);
-  return res;
+  return outgoing.value(dstState).values();
 }
 
 QList<Transition*> State::getTransitionsFrom(State* srcState)
 {
-  QList<Transition *> res;
-  for ( auto a : transitions ) 
-    if ( a->srcState() == srcState ) res.append(a);
-  return res;
+  return incoming.value(srcState).values();
 }
 
 State::Location State::locateEvent(QGraphicsSceneMouseEvent *event)
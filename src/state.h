@@ -14,7 +14,11 @@
 #define STATE_H
 
 #include <QGraphicsPixmapItem>
+#include <QStaticText>
+#include <QPainterPath>
 #include <QList>
+#include <QHash>
+#include <QSet>
 
 QT_BEGIN_NAMESPACE
 class QPixmap;
@@ -40,16 +44,19 @@ public:
     State(QGraphicsItem *parent = 0); // For initial pseudo-states
 
     void removeTransition(Transition *transition);
-    void removeTransitions();
     QPolygonF polygon() const { return myPolygon; }
     void addTransition(Transition *transition);
+    QList<Transition *> getTransitions() const;
+    void collectTransitions(QSet<Transition *>& res) const;
     int type() const override { return Type;}
+    QPainterPath shape() const override { return myShape; }
     QString getId() const { return id; }
-    void setId(QString id) { this->id = id; }
+    void setId(QString id);
     QList<Transition *> getTransitionsTo(State *dstState);
     QList<Transition *> getTransitionsFrom(State *srcState);
     Location locateEvent(QGraphicsSceneMouseEvent* event);
     bool isPseudo() const { return isPseudoState; };
+    void setHighlighted(bool highlighted);
 
     static QSize boxSize;
     static QSize dskSize;
@@ -63,12 +70,18 @@ protected:
     static QColor boxBackground;
     static QColor selectedColor;
     static QColor unSelectedColor;
+    static QColor highlightedColor;
 
 private:
     QString id;
+    QStaticText myIdText;  // Laid out once, when the id changes
     QPolygonF myPolygon;
-    QList<Transition *> transitions;
+    QPainterPath myShape;
+    // Attached transitions, grouped by peer state. Self-transitions appear in both tables
+    QHash<State *, QSet<Transition *> > outgoing;
+    QHash<State *, QSet<Transition *> > incoming;
     bool isPseudoState;
+    bool isHighlighted;  // When being pointed at as the end state of a new transition
 };
 
 #endif // STATE_H
@@ -11,13 +11,17 @@
 /***********************************************************************/
 
 #include "transition.h"
+#include "model.h"
+#include "edgerouter.h"
 #include <math.h>
 #include <QPen>
 #include <QPainter>
+#include <QPainterPathStroker>
+#include <QStyleOptionGraphicsItem>
 #include <QSet>
 #include <QDebug>
 #include "qt_compat.h"
-#include "misc.h"
+#include "lod.h"
 
 QColor Transition::selectedColor = Qt::darkCyan;
 QColor Transition::unSelectedColor = Qt::black;
@@ -29,20 +33,32 @@ Transition::Transition(State *srcState, State *dstState, QString label, State::L
     mySrcState = srcState;
     myDstState = dstState;
     myLocation = location;
-    myLabel = new QGraphicsSimpleTextItem(label, this);
-    myLabel->setFlag(QGraphicsItem::ItemIsSelectable, false);
+    myRank = 0;
+    myBundleSize = 1;
+    isShapeValid = false;
+    myLabel.setTextFormat(Qt::PlainText);
+    myLabel.setText(label);
     setFlag(QGraphicsItem::ItemIsSelectable, true);
     setPen(QPen(unSelectedColor, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
 }
 
 void Transition::setLabel(QString label)
 {
-  myLabel->setText(label);
+  myLabel.setText(label);
+  updatePosition();
 }
 
 QString Transition::getLabel()
 {
-  return myLabel->text();
+  return myLabel.text();
+}
+
+bool Transition::setBundleRank(int rank, int count)
+{
+  if ( rank == myRank && count == myBundleSize ) return false;
+  myRank = rank;
+  myBundleSize = count;
+  return true;
 }
 
 bool Transition::isInitial()
@@ -52,60 +68,53 @@ bool Transition::isInitial()
 
 QRectF Transition::boundingRect() const
 {
-    qreal extra = (pen().width() + 20) / 2.0;
-
-    if ( mySrcState == myDstState )
-      return
-        QRectF(polygon().at(0), polygon().at(2))
-        .normalized()
-        .adjusted(-extra, -extra, extra, extra);
-    else
-      return
-        QRectF(polygon().at(0),
-               QSizeF(polygon().at(1).x() - polygon().at(0).x(),
-                      polygon().at(1).y() - polygon().at(0).y()))
-        .normalized()
-        .adjusted(-extra, -extra, extra, extra);
+    return myBoundingRect;
 }
 
 QPainterPath Transition::shape() const
 {
-    QPainterPath path = QGraphicsPolygonItem::shape();
-    path.addPolygon(arrowHead);
-    return path;
+    // Only needed for hit tests, hence computed on demand rather than at each move.
+    // It is exactly what [paint] covers : the stroked line and arrow head, and the label
+    if ( ! isShapeValid ) {
+      QPainterPath label;
+      if ( ! labelRect().isEmpty() ) label.addRect(labelRect());
+      if ( polygon().isEmpty() )
+        myShape = label;
+      else {
+        QPainterPath outline;
+        outline.addPath(myPath);
+        outline.addPolygon(arrowHead);
+        outline.closeSubpath();
+        QPainterPathStroker stroker;
+        stroker.setWidth(pen().widthF());
+        stroker.setCapStyle(pen().capStyle());
+        stroker.setJoinStyle(pen().joinStyle());
+        QPainterPath head;
+        head.addPolygon(arrowHead);
+        myShape = stroker.createStroke(outline).united(head).united(label);
+        }
+      isShapeValid = true;
+      }
+    return myShape;
 }
 
-void Transition::updatePosition()
+QRectF Transition::labelRect() const
 {
-  QPolygonF p;
-  if ( mySrcState == myDstState ) {
-    float w = State::boxSize.width();
-    float h = State::boxSize.height();
-    p << mapFromItem(mySrcState, 0, -0.25*h)
-      << mapFromItem(mySrcState, 0, 0.25*h)
-      << mapFromItem(mySrcState, w, 0.25*h)
-      << mapFromItem(mySrcState, w, -0.25*h);
-    }
-  else
-    p << mapFromItem(mySrcState, 0, 0)
-      << mapFromItem(myDstState, 0, 0);
-  setPolygon(p);
+    return myLabel.text().isEmpty() ? QRectF() : QRectF(myLabelPos, myLabel.size());
 }
 
-void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *)
+void Transition::updatePosition()
 {
-    // qDebug() << "------------- Transition::paint";
-    // qDebug() << "Drawing transition between state " << mySrcState->getId() << " and " << myDstState->getId();
+    // All the geometry is computed here, and only here, so that painting does not alter the item
 
-    QPen myPen = pen();
-    myPen.setColor(isSelected() ? selectedColor : unSelectedColor);
-    painter->setPen(myPen);
-    painter->setBrush(isSelected() ? selectedColor : unSelectedColor);
+    prepareGeometryChange();
+    isShapeValid = false;
 
     QPolygonF points; // Drawing points
     double angle; // Of the last segment; for drawing the arrow head
     QPointF endPoint; // For anchoring the arrow head
     QPointF midPoint; // For drawing the caption
+    bool curved = false; // Going round other states
 
     float w = State::boxSize.width();
     float h = State::boxSize.height();
@@ -137,6 +146,7 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
         break;
       case State::South:
       case State::None:
+      default:
         points << c + QPointF(0.25*w, 0)
                << c + QPointF(0.25*w, h)
                << c + QPointF(-0.25*w, h)
@@ -150,7 +160,18 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
 
     else { // Normal transition
 
-      if (mySrcState->collidesWithItem(myDstState)) return; // Do not draw if start and end statees collide
+      if (mySrcState->collidesWithItem(myDstState)) { // Nothing to draw if start and end states collide
+        setPolygon(QPolygonF());
+        myPath = QPainterPath();
+        arrowHead.clear();
+        myLabelPos = mySrcState->pos();
+        myBoundingRect = labelRect();
+        // Its former route, if any, must no longer be invalidated by states moving around it
+        Model *model = qobject_cast<Model *>(scene());
+        if (model != NULL)
+            model->edgeRouter().remove(this);
+        return;
+      }
 
       // Find the position where to draw the arrow head
       // This is where the line and the end state intersect
@@ -159,7 +180,7 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
       QPolygonF endPolygon = myDstState->polygon();
       QPointF p1 = endPolygon.first() + myDstState->pos();  // Item to scene coordinates
       QPointF p2;
-      QPointF intersectPoint;
+      QPointF intersectPoint = myDstState->pos();
       QLineF polyLine;
       int side;  // 1: North, 2: East, 3: South, 4: West
       for (side = 1; side < endPolygon.count(); ++side) {
@@ -172,19 +193,10 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
       }
 
       // When there are several transitions between the start and end boxes, we don't one to hide another.
-      // To avoid this, we count them and assign a rank to each one, which will be used as an offset
+      // To avoid this, each one is given a rank (maintained by the model), which will be used as an offset
       
-      QList<Transition*> transitions = mySrcState->getTransitionsTo(myDstState) + myDstState->getTransitionsTo(mySrcState);
-      // for ( auto a: transitions ) 
-      //   qDebug() << "  " << a->srcState()->getId() << " -> " << a->dstState()->getId();
-      transitions = remove_duplicates(transitions); 
-      std::sort(transitions.begin(), transitions.end()); // Sorting ensures that the order does not depend on the start state
-      int rank = -1;
-      for ( int i=0; i<transitions.length() && rank<0; i++ )
-        if ( transitions.at(i) == this ) rank = i;
-      if ( rank == -1 ) throw std::invalid_argument(std::string("Transition::paint:compute_rank"));
-
-      int n = transitions.length();
+      int rank = myRank;
+      int n = myBundleSize;
       QPointF offset;
       switch ( side ) {
       case 1: case 3: 
@@ -196,15 +208,31 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
       }
 
       QLineF line = QLineF(intersectPoint+offset, mySrcState->pos()+offset);
-      points << line.p1() << line.p2();
 
-      angle = ::acos(line.dx() / line.length());
-      if (line.dy() >= 0) angle = (M_PI * 2) - angle;
+      // States lying on the way are avoided. Routes are computed, and cached, by the model
+      QPolygonF waypoints;
+      Model *model = qobject_cast<Model *>(scene());
+      if (model != NULL)
+        waypoints = model->edgeRouter().route(this, line.p2(), line.p1());
+      points << line.p1();
+      for (int i = waypoints.count()-1; i >= 0; i--)
+        points << waypoints.at(i);
+      points << line.p2();
+      curved = ! waypoints.isEmpty();
+
+      QLineF last = QLineF(points.at(0), points.at(1)); // Gives the direction of the arrow head
+      angle = ::acos(last.dx() / last.length());
+      if (last.dy() >= 0) angle = (M_PI * 2) - angle;
       endPoint = line.p1();
-      midPoint = (line.p1() + line.p2())/2;
+      midPoint = curved ? waypoints.at(waypoints.count()/2) : (line.p1() + line.p2())/2;
     }
 
     setPolygon(points);  // The recorded polygon does not include the arrow head
+    myPath = QPainterPath();
+    if ( curved )
+      myPath = EdgeRouter::spline(points);
+    else
+      myPath.addPolygon(points);
     
     // Build arrow head  
 
@@ -213,10 +241,34 @@ void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWid
     arrowHead.clear();
     arrowHead << endPoint << arrowP1 << arrowP2;
 
-    // Draw all
-    
-    painter->drawPolyline(points);
-    painter->drawPolygon(arrowHead);
+    myLabelPos = midPoint;
+
+    // Half the pen width around the line and arrow head, plus a pixel for antialiasing : views
+    // repaint no more than needed when the transition moves
+    qreal extra = pen().widthF() / 2 + 1;
+    myBoundingRect = myPath.controlPointRect().united(arrowHead.boundingRect()).adjusted(-extra, -extra, extra, extra);
+    if ( ! labelRect().isEmpty() ) myBoundingRect |= labelRect();
+}
 
-    myLabel->setPos(midPoint);
+void Transition::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if ( ! polygon().isEmpty() ) {
+      QPen myPen = pen();
+      myPen.setColor(isSelected() ? selectedColor : unSelectedColor);
+      if ( lod < Lod::outline ) myPen.setWidth(0);  // Cosmetic, 1 pixel wide
+      painter->setPen(myPen);
+      painter->setBrush(isSelected() ? selectedColor : unSelectedColor);
+      painter->strokePath(myPath, myPen);
+      if ( lod >= Lod::text )
+        painter->drawPolygon(arrowHead);
+      }
+
+    // The label is not a separate item, which would double the number of items in the scene.
+    // It is not drawn when too small to be read
+    if ( lod >= Lod::text && ! myLabel.text().isEmpty() ) {
+      painter->setPen(unSelectedColor);
+      painter->drawStaticText(myLabelPos, myLabel);
+      }
 }
@@ -14,7 +14,8 @@
 #define TRANSITION_H
 
 #include <QGraphicsPolygonItem>
-#include <QGraphicsSimpleTextItem>
+#include <QStaticText>
+#include <QPainterPath>
 #include "state.h"
 
 QT_BEGIN_NAMESPACE
@@ -44,8 +45,9 @@ public:
     void setDstState(State *s) { myDstState = s; }
     void setLabel(QString s);
     bool isInitial();
+    bool setBundleRank(int rank, int count);  // Returns true if the geometry is to be updated
 
-    void updatePosition();
+    void updatePosition();  // Recomputes the cached geometry; to be called whenever an end state moves
 
     static QColor selectedColor;
     static QColor unSelectedColor;
@@ -55,11 +57,20 @@ protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) override;
 
 private:
+    QRectF labelRect() const;
+
     State *mySrcState;
     State *myDstState;
     QPolygonF arrowHead;
-    QGraphicsSimpleTextItem *myLabel;
+    QPainterPath myPath;  // The line, straight or curved, without the arrow head
+    QRectF myBoundingRect;
+    mutable QPainterPath myShape;
+    mutable bool isShapeValid;
+    QStaticText myLabel;
+    QPointF myLabelPos;  // Top-left corner
     State::Location myLocation;
+    int myRank;         // Rank of this transition among those linking the same two states
+    int myBundleSize;   // Number of transitions linking these two states
 };
 
 #endif // TRANSITION_H